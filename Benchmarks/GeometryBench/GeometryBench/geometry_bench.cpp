@@ -0,0 +1,257 @@
+// GeometryBench: microbenchmarks for the CPU side of the homework programs
+//      - Cylinder::dynamic_vertice_mapping / dynamic_index_mapping (HW09)
+//      - Cylinder::optimizeMesh: quantization + weld + vertex cache + vertex fetch optimization
+//      - Cylinder::render: in-place buffer update after a tessellation change
+//      - hexagonal prism dynamic_vertice_mapping (HW07, HW08)
+//      - glm matrix chains of render() (HW05, HW06)
+//      - compute_contact (HW04)
+//
+//      Every benchmark reports ns/op (time column) and bytes/op (counter).
+//      Save a JSON baseline with
+//          GeometryBench.exe --benchmark_out=baseline.json --benchmark_out_format=json
+//      and compare two baselines with tools/compare.py of Google Benchmark.
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+
+#include <hexprism.h>
+#include <contact.h>
+#include "cylinder.h"
+
+using namespace std;
+
+// Function Prototypes
+GLFWwindow* glAllInit();
+
+// Global variables
+Cylinder* cylinder = NULL;
+
+
+// report bytes/op as a counter and bytes/s as throughput
+static void setBytesPerOp(benchmark::State& state, size_t bytes) {
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(bytes));
+    state.counters["bytes/op"] = benchmark::Counter(double(bytes));
+}
+
+// HW09 cylinder side: 4 vertices per segment, always the runtime sin/cos generator
+// (dynamic_vertice_mapping() copies compile-time tables for some n; PrimitivesTest checks those)
+static void BM_CylinderVertices(benchmark::State& state) {
+    int n = (int)state.range(0);
+    for (auto _ : state) {
+        Cylinder::side_mapping(n, false, cylinder->cylinderVertices, cylinder->cylinderNormals,
+                               cylinder->cylinderColors, cylinder->cylinderTexCoords);
+        benchmark::DoNotOptimize(cylinder->cylinderVertices.data());
+        benchmark::ClobberMemory();
+    }
+    // positions, normals and colors (3 floats), texture coordinates (2 floats)
+    setBytesPerOp(state, n * 4 * (3 + 3 + 3 + 2) * sizeof(GLfloat));
+}
+BENCHMARK(BM_CylinderVertices)->RangeMultiplier(4)->Range(6, 6144);
+
+static void BM_CylinderIndices(benchmark::State& state) {
+    int n = (int)state.range(0);
+    for (auto _ : state) {
+        cylinder->dynamic_index_mapping(n);
+        benchmark::DoNotOptimize(cylinder->cylinderIndices.data());
+        benchmark::ClobberMemory();
+    }
+    setBytesPerOp(state, n * 6 * sizeof(unsigned int));
+}
+BENCHMARK(BM_CylinderIndices)->RangeMultiplier(4)->Range(6, 6144);
+
+static void BM_CylinderOptimize(benchmark::State& state) {
+    int n = (int)state.range(0);
+    cylinder->n = n;
+    cylinder->dynamic_vertice_mapping(n, false);
+    cylinder->dynamic_index_mapping(n);
+    vector<Cylinder::Vertex> vertices;
+    vector<unsigned int> indices;
+    for (auto _ : state) {
+        cylinder->optimizeMesh(vertices, indices);
+        benchmark::DoNotOptimize(indices.data());
+    }
+    cylinder->n = 48;
+    state.counters["ACMR"] = benchmark::Counter(cylinder->acmrAfter);
+    setBytesPerOp(state, n * 4 * sizeof(Cylinder::Vertex) + n * 6 * sizeof(unsigned int));
+}
+BENCHMARK(BM_CylinderOptimize)->RangeMultiplier(4)->Range(6, 6144);
+
+// interactive tessellation change: alternate between n and n + 1 segments
+static void BM_CylinderRetessellate(benchmark::State& state) {
+    int n = (int)state.range(0);
+    size_t uploaded = cylinder->VBO.bytesUploaded + cylinder->EBO.bytesUploaded;
+    int step = 0;
+    for (auto _ : state) {
+        cylinder->n = n + (step++ & 1);
+        cylinder->render();
+    }
+    glFinish();
+    uploaded = cylinder->VBO.bytesUploaded + cylinder->EBO.bytesUploaded - uploaded;
+    state.counters["reallocations"] = benchmark::Counter(cylinder->VBO.reallocations);
+    setBytesPerOp(state, state.iterations() > 0 ? uploaded / state.iterations() : 0);
+    cylinder->n = 48;
+    cylinder->render();
+}
+BENCHMARK(BM_CylinderRetessellate)->RangeMultiplier(4)->Range(6, 6144);
+
+// HW07/HW08 hexagonal prism, one prism per op
+static void BM_HexPrismVertices(benchmark::State& state) {
+    GLfloat hexVertices[HEX_VERTEX_FLOATS];
+    GLfloat hexNormals[HEX_NORMAL_FLOATS];
+    GLfloat hexColors[HEX_COLOR_FLOATS];
+    GLfloat hexTexCoords[HEX_TEXCOORD_FLOATS];
+    for (auto _ : state) {
+        hex_prism_vertice_mapping(hexVertices, hexNormals, hexColors, hexTexCoords);
+        benchmark::DoNotOptimize(hexVertices);
+        benchmark::ClobberMemory();
+    }
+    setBytesPerOp(state, sizeof(hexVertices) + sizeof(hexNormals) + sizeof(hexColors) + sizeof(hexTexCoords));
+}
+BENCHMARK(BM_HexPrismVertices);
+
+// HW05 render(): the three rotating rectangles, evaluated for range(0) time steps
+static void BM_Hw05Transforms(benchmark::State& state) {
+    int frames = (int)state.range(0);
+    float speed1 = glm::radians(360.0f);
+    float speed2 = glm::radians(90.0f);
+    float speed4 = glm::radians(180.0f);
+    vector<glm::mat4> transforms(frames * 3);
+
+    for (auto _ : state) {
+        for (int i = 0; i < frames; i++) {
+            float currentTime = i / 60.0f;
+            glm::mat4 transform;
+
+            // green rectangle
+            transform = glm::mat4(1.0f);
+            transform = glm::rotate(transform, speed1 * currentTime, glm::vec3(0.0f, 0.0f, 1.0f));
+            transforms[i * 3] = transform;
+
+            // yellow rectangle
+            float spiral = sin(currentTime / 3);
+            transform = glm::mat4(1.0f);
+            transform = glm::rotate(transform, speed2 * currentTime, glm::vec3(0.0f, 0.0f, 1.0f));
+            transform = glm::translate(transform, glm::vec3(0.5f * spiral, 0.0f, 0.0f));
+            transforms[i * 3 + 1] = transform;
+
+            // red rectangle
+            transform = glm::rotate(transform, speed4 * currentTime, glm::vec3(0.0f, 0.0f, 1.0f));
+            transform = glm::translate(transform, glm::vec3(0.0f, 0.1f, 0.0f));
+            transform = glm::scale(transform, glm::vec3(1.0f, 4.0f, 1.0f));
+            transforms[i * 3 + 2] = transform;
+        }
+        benchmark::DoNotOptimize(transforms.data());
+        benchmark::ClobberMemory();
+    }
+    setBytesPerOp(state, transforms.size() * sizeof(glm::mat4));
+}
+BENCHMARK(BM_Hw05Transforms)->RangeMultiplier(8)->Range(1, 4096);
+
+// HW06 render(): orbiting cube and orbiting camera, evaluated for range(0) time steps
+static void BM_Hw06CameraCircle(benchmark::State& state) {
+    int frames = (int)state.range(0);
+    vector<glm::mat4> matrices(frames * 2);
+
+    for (auto _ : state) {
+        for (int i = 0; i < frames; i++) {
+            double time = i / 60.0;
+            float cubeAngle = (time / 5.0) * 2.0 * M_PI;
+            float cubeX = cos(cubeAngle) * 5.0f;
+            float cubeZ = sin(cubeAngle) * 5.0f;
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(cubeX, 0.0f, cubeZ));
+
+            float camAngle = (time / 8.0) * 2.0 * M_PI;
+            float camX = cos(camAngle) * 7.0f;
+            float camY = sin(camAngle) * 7.0f;
+            glm::mat4 view = glm::lookAt(glm::vec3(camX, camY, -8.0f),
+                                         glm::vec3(cubeX, 0.0f, cubeZ),
+                                         glm::vec3(0.0f, 1.0f, 0.0f));
+            matrices[i * 2] = model;
+            matrices[i * 2 + 1] = view;
+        }
+        benchmark::DoNotOptimize(matrices.data());
+        benchmark::ClobberMemory();
+    }
+    setBytesPerOp(state, matrices.size() * sizeof(glm::mat4));
+}
+BENCHMARK(BM_Hw06CameraCircle)->RangeMultiplier(8)->Range(1, 4096);
+
+// HW04 compute_contact(): range(0) random segments in normalized device coordinates
+static void BM_ComputeContact(benchmark::State& state) {
+    int segments = (int)state.range(0);
+    vector<float> lines(segments * 4);
+    srand(2024);
+    for (size_t i = 0; i < lines.size(); i++)
+        lines[i] = (rand() / (float)RAND_MAX) * 2.0f - 1.0f;
+    float interV[4];
+
+    for (auto _ : state) {
+        int nInter = 0;
+        for (int i = 0; i < segments; i++)
+            nInter += quadratic_line_contact(&lines[i * 4], interV);
+        benchmark::DoNotOptimize(nInter);
+        benchmark::DoNotOptimize(interV);
+    }
+    setBytesPerOp(state, lines.size() * sizeof(float));
+}
+BENCHMARK(BM_ComputeContact)->RangeMultiplier(8)->Range(1, 4096);
+
+
+int main(int argc, char** argv)
+{
+    // Cylinder uploads its buffers in the constructor, so a (hidden) GL context is needed
+    GLFWwindow* window = glAllInit();
+    cylinder = new Cylinder(48);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
+
+GLFWwindow* glAllInit()
+{
+    GLFWwindow* window;
+
+    // glfw: initialize and configure
+    if (!glfwInit()) {
+        printf("GLFW initialisation failed!");
+        glfwTerminate();
+        exit(-1);
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    // glfw window creation
+    window = glfwCreateWindow(64, 64, "GeometryBench", NULL, NULL);
+    if (window == NULL) {
+        cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        exit(-1);
+    }
+    glfwMakeContextCurrent(window);
+
+    // Allow modern extension features
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        cout << "GLEW initialisation failed!" << endl;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        exit(-1);
+    }
+
+    return window;
+}
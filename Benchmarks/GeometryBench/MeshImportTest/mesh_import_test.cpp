@@ -0,0 +1,198 @@
+// MeshImportTest: the OBJ importer and its cache (utils/mesh_import.h) against meshes
+// written out by hand
+//      - one block of v/vt/vn/f lines: quads, absolute and relative (negative) indices,
+//        v, v//vn and v/vt/vn corners, missing normals and texcoords
+//      - the block repeated past the 1 MB single-thread limit, every copy moved along x,
+//        parsed with 1 to 16 threads: the chunks are cut mid-file and the relative
+//        indices only resolve right when every chunk's prefix sum is right
+//      - the cache round trip: importMesh() writes "<path>.cache", openCache() maps it
+//        back, and the mapped file holds the same triangles as the source
+//      Prints one line per test and returns 1 when any of them fails. Needs no GL context.
+
+#include <GL/glew.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+#include <mesh_import.h>
+
+using namespace std;
+
+#define TEST_OBJ_PATH "mesh_import_test.obj"
+
+// relative indices resolve inside the block, absolute ones to the first block's vertices
+static const char* OBJ_BLOCK =
+    "# unit quad at x = %d\n"
+    "v %d 0 0\n"
+    "v %d 0 0\n"
+    "v %d 1 0\n"
+    "v %d 1 0\n"
+    "vt 0 0\n"
+    "vt 1 0\n"
+    "vt 1 1\n"
+    "vn 0 0 1\n"
+    "f -4/-3/-1 -3/-2/-1 -2/-1/-1 -1/-1/-1\n"
+    "f 1 2 3\n"
+    "f 1//1 3//1 4//1\n";
+
+#define BLOCK_TRIANGLES 4
+
+static string objText(int blocks) {
+    string text;
+    char line[512];
+    for (int b = 0; b < blocks; b++) {
+        snprintf(line, sizeof(line), OBJ_BLOCK, b, b, b + 1, b + 1, b);
+        text += line;
+    }
+    return text;
+}
+
+static MeshFormat::Vertex vertex(float x, float y, const glm::vec2& texCoord) {
+    MeshFormat::Vertex v;
+    v.set<Position3f>(glm::vec3(x, y, 0.0f));
+    v.set<Normal3f>(glm::vec3(0.0f, 0.0f, 1.0f));    // given or the face normal, the same here
+    v.set<TexCoord2f>(texCoord);
+    return v;
+}
+
+// the un-welded triangle vertices import_obj() must produce
+static vector<MeshFormat::Vertex> expectedVertices(int blocks) {
+    vector<MeshFormat::Vertex> vertices;
+    glm::vec2 t0(0.0f, 0.0f), t1(1.0f, 0.0f), t2(1.0f, 1.0f);
+    for (int b = 0; b < blocks; b++) {
+        float x0 = (float)b, x1 = (float)(b + 1);
+        // the quad as a fan around its first corner
+        vertices.push_back(vertex(x0, 0.0f, t0));
+        vertices.push_back(vertex(x1, 0.0f, t1));
+        vertices.push_back(vertex(x1, 1.0f, t2));
+        vertices.push_back(vertex(x0, 0.0f, t0));
+        vertices.push_back(vertex(x1, 1.0f, t2));
+        vertices.push_back(vertex(x0, 1.0f, t2));
+        // absolute indices: the first block, no texcoords
+        vertices.push_back(vertex(0.0f, 0.0f, t0));
+        vertices.push_back(vertex(1.0f, 0.0f, t0));
+        vertices.push_back(vertex(1.0f, 1.0f, t0));
+        vertices.push_back(vertex(0.0f, 0.0f, t0));
+        vertices.push_back(vertex(1.0f, 1.0f, t0));
+        vertices.push_back(vertex(0.0f, 1.0f, t0));
+    }
+    return vertices;
+}
+
+static bool report(const string& name, bool ok, const string& detail) {
+    cout << (ok ? "ok   " : "FAIL ") << name << ": " << detail << endl;
+    return ok;
+}
+
+static bool sameVertices(const vector<MeshFormat::Vertex>& a, const vector<MeshFormat::Vertex>& b) {
+    return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * MeshFormat::stride) == 0);
+}
+
+static bool testParse(const string& name, int blocks, unsigned int threads) {
+    string text = objText(blocks);
+    MeshData mesh;
+    bool parsed = import_obj(text.data(), text.size(), mesh, threads);
+    bool ok = parsed && sameVertices(mesh.vertices, expectedVertices(blocks))
+           && mesh.boundsMin == glm::vec3(0.0f) && mesh.boundsMax == glm::vec3((float)blocks, 1.0f, 0.0f);
+    return report(name, ok, to_string(text.size()) + " bytes, " + to_string(mesh.vertices.size() / 3) + " triangles, "
+                            + to_string(blocks * BLOCK_TRIANGLES) + " in the source");
+}
+
+// a triangle as the bytes of its three vertices, rotated to start at the smallest (winding kept)
+static string triangleKey(const MeshFormat::Vertex* corners[3]) {
+    int first = 0;
+    for (int k = 1; k < 3; k++)
+        if (memcmp(corners[k]->bytes, corners[first]->bytes, MeshFormat::stride) < 0) first = k;
+    string key;
+    for (int k = 0; k < 3; k++) key.append((const char*)corners[(first + k) % 3]->bytes, MeshFormat::stride);
+    return key;
+}
+
+static bool testCacheRoundTrip(int blocks) {
+    string text = objText(blocks);
+    string cachePath = string(TEST_OBJ_PATH) + ".cache";
+    remove(cachePath.c_str());
+    {
+        ofstream out(TEST_OBJ_PATH, ios::binary);
+        out.write(text.data(), text.size());
+    }
+
+    MeshData mesh;
+    IndexData packed;
+    MeshCacheHeader header = {};
+    MappedFile cache;
+    bool ok = MeshAsset::importMesh(TEST_OBJ_PATH, 4, mesh, packed, header) && MeshAsset::openCache(TEST_OBJ_PATH, cache);
+
+    // the mapped file is exactly what importMesh() kept in memory
+    size_t vertexBytes = mesh.vertices.size() * MeshFormat::stride;
+    ok = ok && cache.size == sizeof(header) + vertexBytes + packed.size()
+            && memcmp(cache.data, &header, sizeof(header)) == 0
+            && memcmp(cache.data + sizeof(header), mesh.vertices.data(), vertexBytes) == 0
+            && memcmp(cache.data + sizeof(header) + vertexBytes, packed.data(), packed.size()) == 0;
+
+    // and holds the source's triangles, welded and reordered
+    vector<string> expected, cached;
+    if (ok) {
+        vector<MeshFormat::Vertex> vertices = expectedVertices(blocks);
+        for (size_t i = 0; i < vertices.size(); i += 3) {
+            const MeshFormat::Vertex* corners[3] = { &vertices[i], &vertices[i + 1], &vertices[i + 2] };
+            expected.push_back(triangleKey(corners));
+        }
+        const MeshCacheHeader* mapped = (const MeshCacheHeader*)cache.data;
+        const MeshFormat::Vertex* cacheVertices = (const MeshFormat::Vertex*)(cache.data + sizeof(header));
+        const unsigned char* indices = cache.data + sizeof(header) + vertexBytes;
+        for (uint32_t i = 0; i < mapped->indexCount && ok; i += 3) {
+            const MeshFormat::Vertex* corners[3];
+            for (int k = 0; k < 3; k++) {
+                uint32_t index;
+                if (mapped->indexType == GL_UNSIGNED_SHORT) {
+                    uint16_t shortIndex;
+                    memcpy(&shortIndex, indices + (i + k) * 2, 2);
+                    index = shortIndex;
+                }
+                else memcpy(&index, indices + (i + k) * 4, 4);
+                ok = ok && index < mapped->vertexCount;
+                corners[k] = cacheVertices + (ok ? index : 0);
+            }
+            cached.push_back(triangleKey(corners));
+        }
+        sort(expected.begin(), expected.end());
+        sort(cached.begin(), cached.end());
+        ok = ok && expected == cached;
+    }
+    string detail = to_string(header.vertexCount) + " welded vertices, " + to_string(cached.size()) + " of "
+                  + to_string(expected.size()) + " triangles mapped back";
+
+    // a changed source makes the cache stale
+    cache.close();
+    {
+        ofstream out(TEST_OBJ_PATH, ios::binary | ios::app);
+        out << "# edited\n";
+    }
+    bool stale = !MeshAsset::openCache(TEST_OBJ_PATH, cache);
+    if (!stale) detail += ", still used after the source changed";
+
+    remove(cachePath.c_str());
+    remove(TEST_OBJ_PATH);
+    return report("cache round trip", ok && stale, detail);
+}
+
+int main()
+{
+    bool ok = testParse("one block", 1, 0);
+
+    // past the 1 MB limit below which import_obj() stays on one thread
+    int blocks = (int)((1 << 20) / objText(1).size()) * 2;
+    unsigned int threadCounts[] = { 1, 2, 3, 7, 16 };
+    for (unsigned int threads : threadCounts)
+        ok &= testParse(to_string(blocks) + " blocks, " + to_string(threads) + " threads", blocks, threads);
+
+    ok &= testCacheRoundTrip(blocks);
+
+    cout << (ok ? "importer and cache match the source" : "importer or cache differ from the source") << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+// PrimitivesTest: the compile-time tables of primitives.h against the runtime generators
+//      - Prism<6> (HexPrism) against hex_prism_vertice_mapping() (HW07, HW08)
+//      - CylinderShape<N, S> against Cylinder::side_mapping() / index_mapping() (HW09),
+//        for every N the Cylinder copies from tables, smooth and flat
+//
+//      A float may differ by MAX_ULPS units in the last place, or by MAX_ABSOLUTE: the
+//      tables use a constexpr series, the generators the library sin/cos, and the two do
+//      not always round the same way. Near zero the last place is tiny, so cos(pi / 2)
+//      of a float angle (about -4.4e-8) differs in its last bits, and sin(pi) of a
+//      double angle (about 1.2e-16) may even differ in sign. Indices must be equal.
+//      Prints one line per table and returns 1 when any of them fails.
+
+#include <GL/glew.h>
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include <primitives.h>
+#include <hexprism.h>
+#include "cylinder.h"
+
+using namespace std;
+
+#define MAX_ULPS 2
+#define MAX_ABSOLUTE 1e-12
+
+// distance of two floats in representable steps
+static int64_t ulpDistance(float a, float b) {
+    int32_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    // sign-magnitude to a monotonic integer line
+    int64_t la = ia < 0 ? -(int64_t)(ia & 0x7FFFFFFF) : ia;
+    int64_t lb = ib < 0 ? -(int64_t)(ib & 0x7FFFFFFF) : ib;
+    return la > lb ? la - lb : lb - la;
+}
+
+struct Result {
+    size_t values = 0, exact = 0, failed = 0;
+    int64_t maxUlps = 0;            // of the values farther apart than MAX_ABSOLUTE
+    double maxAbsolute = 0.0;
+};
+
+static void compareFloats(Result& result, const GLfloat* table, const GLfloat* reference, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        int64_t ulps = ulpDistance(table[i], reference[i]);
+        double difference = fabs((double)table[i] - (double)reference[i]);
+        result.values++;
+        if (ulps == 0) result.exact++;
+        if (ulps > MAX_ULPS && difference > MAX_ABSOLUTE) result.failed++;
+        if (difference > result.maxAbsolute) result.maxAbsolute = difference;
+        if (difference > MAX_ABSOLUTE && ulps > result.maxUlps) result.maxUlps = ulps;
+    }
+}
+
+template <typename Index>
+static void compareIndices(Result& result, const Index* table, const unsigned int* reference, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        result.values++;
+        if (table[i] == reference[i]) result.exact++;
+        else result.failed++;
+    }
+}
+
+static bool report(const char* name, const Result& result) {
+    cout << (result.failed == 0 ? "ok   " : "FAIL ") << name << ": " << result.exact << " of " << result.values
+         << " values equal, largest difference " << result.maxAbsolute << ", " << result.maxUlps
+         << " ulps above " << MAX_ABSOLUTE;
+    if (result.failed > 0) cout << ", " << result.failed << " beyond tolerance";
+    cout << endl;
+    return result.failed == 0;
+}
+
+static bool testHexPrism() {
+    GLfloat vertices[HEX_VERTEX_FLOATS], normals[HEX_NORMAL_FLOATS];
+    GLfloat colors[HEX_COLOR_FLOATS], texCoords[HEX_TEXCOORD_FLOATS];
+    hex_prism_vertice_mapping(vertices, normals, colors, texCoords);
+
+    Result result;
+    compareFloats(result, HexPrism::tables.vertices, vertices, HEX_VERTEX_FLOATS);
+    compareFloats(result, HexPrism::tables.normals, normals, HEX_NORMAL_FLOATS);
+    compareFloats(result, HexPrism::tables.colors, colors, HEX_COLOR_FLOATS);
+    compareFloats(result, HexPrism::tables.texCoords, texCoords, HEX_TEXCOORD_FLOATS);
+    return report("Prism<6>", result);
+}
+
+template <int N, Shading S>
+static bool testCylinder(const char* name) {
+    vector<GLfloat> vertices, normals, colors, texCoords;
+    vector<unsigned int> indices;
+    Cylinder::side_mapping(N, S == SHADING_FLAT, vertices, normals, colors, texCoords);
+    Cylinder::index_mapping(N, indices);
+
+    typedef CylinderShape<N, S> Shape;
+    Result result;
+    compareFloats(result, Shape::tables.vertices, vertices.data(), vertices.size());
+    compareFloats(result, Shape::tables.normals, normals.data(), normals.size());
+    compareFloats(result, Shape::tables.colors, colors.data(), colors.size());
+    compareFloats(result, Shape::tables.texCoords, texCoords.data(), texCoords.size());
+    compareIndices(result, Shape::tables.indices, indices.data(), indices.size());
+    return report(name, result);
+}
+
+int main()
+{
+    bool ok = testHexPrism();
+    ok &= testCylinder<6, SHADING_SMOOTH>("CylinderShape<6, smooth>");
+    ok &= testCylinder<6, SHADING_FLAT>("CylinderShape<6, flat>");
+    ok &= testCylinder<12, SHADING_SMOOTH>("CylinderShape<12, smooth>");
+    ok &= testCylinder<12, SHADING_FLAT>("CylinderShape<12, flat>");
+    ok &= testCylinder<24, SHADING_SMOOTH>("CylinderShape<24, smooth>");
+    ok &= testCylinder<24, SHADING_FLAT>("CylinderShape<24, flat>");
+    ok &= testCylinder<48, SHADING_SMOOTH>("CylinderShape<48, smooth>");
+    ok &= testCylinder<48, SHADING_FLAT>("CylinderShape<48, flat>");
+
+    cout << (ok ? "all tables within " : "tables differ by more than ") << MAX_ULPS << " ulps or "
+         << MAX_ABSOLUTE << " of the generators" << endl;
+    return ok ? 0 : 1;
+}
@@ -1,5 +1,6 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <gl_state.h>
 
 #include <iostream>
 #include <cmath>
@@ -158,26 +159,25 @@ int main()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        if (fillMode)
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        else
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        // only reaches GL when fillMode was toggled
+        gl_state().polygonMode(fillMode ? GL_FILL : GL_LINE);
 
         // draw circle
-        glUseProgram(shaderProgram);
-        glBindVertexArray(VAO_circle);
+        gl_state().useProgram(shaderProgram);
+        gl_state().bindVertexArray(VAO_circle);
         glDrawArrays(GL_TRIANGLE_FAN, 0, numTriangles + 2);
 
         //
                 // draw hexagon
-        glUseProgram(shaderProgram2);
-        glBindVertexArray(VAO_hexagon);
+        gl_state().useProgram(shaderProgram2);
+        gl_state().bindVertexArray(VAO_hexagon);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 6);
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
         glfwPollEvents();
+        gl_state().endFrame();
     }
 
     // optional: de-allocate all resources once they've outlived their purpose:
@@ -2,7 +2,11 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cmath>
+#include <cstring>
 #include <shader.h>
+#include <contact.h>
+#include <gl_state.h>
+#include <ring_buffer.h>
 
 using namespace std;
 
@@ -25,11 +29,15 @@ bool dragging = false;
 bool complete = false;
 int nInter = 0;
 float interV[4];
-unsigned int interVAO, VAO[2];
-unsigned int interVBO, VBO[2];
+unsigned int VAO[2];
+unsigned int VBO;
 float quadFunc[130];
 float lineVer[4];
 
+// the rubber-band line and the intersections are rewritten into the ring every frame;
+// VAO[1] reads it, the frame's offset becomes the first vertex of the draw
+RingBuffer* stream = NULL;
+
 
 int main()
 {
@@ -51,14 +59,12 @@ int main()
     }
 
 
-    glGenVertexArrays(1, &interVAO);
-    glGenBuffers(1, &interVBO);
     glGenVertexArrays(2, VAO);
-    glGenBuffers(2, VBO);
+    glGenBuffers(1, &VBO);
 
     glBindVertexArray(VAO[0]);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(quadFunc), quadFunc, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
@@ -66,18 +72,15 @@ int main()
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    glBindVertexArray(VAO[1]);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(lineVer), lineVer, GL_STATIC_DRAW);
+    // the ring binds itself through the state cache, which must see the VAO too
+    gl_state().bindVertexArray(VAO[1]);
 
+    stream = new RingBuffer(GL_ARRAY_BUFFER, 4096);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
     ourShader->use();
+    glPointSize(10.0f);
 
     // render loop
     // -----------
@@ -87,30 +90,37 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT);
 
         ourShader->setVec4("inColor", 1.0f, 0.0f, 0.0f, 1.0f);
-        glBindVertexArray(VAO[0]);
+        gl_state().bindVertexArray(VAO[0]);
         glDrawArrays(GL_LINE_STRIP, 0, 65);
-        glBindVertexArray(0);
-
-        ourShader->setVec4("inColor", 0.0f, 1.0f, 0.0f, 1.0f);
-        glBindVertexArray(VAO[1]);
-        glDrawArrays(GL_LINES, 0, 2);
-        glBindVertexArray(0);
-
-        if (nInter > 0) {
-            glPointSize(10.0f);
-            ourShader->setVec4("inColor", 1.0f, 1.0f, 0.0f, 1.0f);
-            glBindVertexArray(interVAO);
-            glDrawArrays(GL_POINTS, 0, nInter);
-            glBindVertexArray(0);
+
+        // line vertices, then the intersections
+        GLintptr offset;
+        // a failed map (full region, lost mapping) skips the line for this frame
+        float* v = (float*)stream->map(sizeof(lineVer) + sizeof(interV), offset, 2 * sizeof(float));
+        if (v != NULL) {
+            memcpy(v, lineVer, sizeof(lineVer));
+            memcpy(v + 4, interV, sizeof(interV));
+            stream->unmap();
+            GLint first = (GLint)(offset / (2 * sizeof(float)));
+
+            ourShader->setVec4("inColor", 0.0f, 1.0f, 0.0f, 1.0f);
+            gl_state().bindVertexArray(VAO[1]);
+            glDrawArrays(GL_LINES, first, 2);
+
+            if (nInter > 0) {
+                ourShader->setVec4("inColor", 1.0f, 1.0f, 0.0f, 1.0f);
+                glDrawArrays(GL_POINTS, first + 2, nInter);
+            }
         }
 
         glfwSwapBuffers(window);
+        stream->endFrame();
         glfwPollEvents();
+        gl_state().endFrame();
     }
-    glDeleteVertexArrays(2, VAO);
-    glDeleteBuffers(2, VBO);
-    glDeleteVertexArrays(1, &interVAO);
-    glDeleteBuffers(1, &interVBO);
+    delete stream;
+    gl_state().deleteVertexArrays(2, VAO);
+    gl_state().deleteBuffers(1, &VBO);
     glfwTerminate();
     return 0;
 }
@@ -206,59 +216,15 @@ void normalize_cursor_position(double x, double y, float &nx, float &ny)
     ny = -1.0f * (((float)y / (float)SCR_HEIGHT) * 2.0f - 1.0f);
 }
 
+// CPU copy only: the render loop streams lineVer into the ring every frame
 void update_vb_vertex(int vindex, float x, float y)
 {
-    float n[2];
-    n[0] = x;
-    n[1] = y;
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-    glBufferSubData(GL_ARRAY_BUFFER, vindex * 2 * sizeof(float), sizeof(float) * 2, n);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    lineVer[vindex * 2] = x;
+    lineVer[vindex * 2 + 1] = y;
 }
 
 void compute_contact() {
-    float a = lineVer[2] - lineVer[0],
-          b = lineVer[0],
-          c = lineVer[3] - lineVer[1],
-          d = lineVer[1];
-    float A = float(pow(a, 2)) * 2.0f,
-          B = (4.0f * a * b) - (0.8f * a) - c,
-          C = (float(pow(b, 2)) * 2.0f) - (0.8f * b) - d - 0.42f;
-    float D = float(pow(B, 2)) - (4 * A * C);
-    int vindex = 0;
-    if (D < 0) return;
-    if (D > 0) {
-        float t1 = (float(sqrt(D)) - B) / (2 * A),
-              t2 = (float(sqrt(D)) + B) / (2 * A);
-        t2 = -t2;
-        if (0 <= t1 && t1 <= 1) {
-            interV[vindex++] = a * t1 + b;
-            interV[vindex++] = c * t1 + d;
-            nInter++;
-        }
-        if (0 <= t2 && t2 <= 1) {
-            interV[vindex++] = a * t2 + b;
-            interV[vindex++] = c * t2 + d;
-            nInter++;
-        }
-    }
-    else if (D == 0) {
-        float t1 = B / (2 * A);
-        B = -B;
-        if (0 <= t1 && 1 <= t1) {
-            interV[vindex++] = a * t1 + b;
-            interV[vindex++] = c * t1 + d;
-            nInter++;
-        }
-    }
-
-    glBindVertexArray(interVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, interVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(interV), interV, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    nInter = quadratic_line_contact(lineVer, interV);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -1,3 +1,7 @@
+// Homework05: three rectangles animated by composed rotations and translations,
+// and a GPU particle system of the same rectangle moving on spiral orbits
+//      Keyboard: 'p' - toggle the particles
+//                '=' / '-' - double/halve the particle count
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -7,6 +11,9 @@
 #include <iostream>
 #include <cmath>
 #include <shader.h>
+#include <gl_state.h>
+#include <shader_manager.h>
+#include <gpu_particles.h>
 
 using namespace std;
 
@@ -34,18 +41,33 @@ float speed2 = glm::radians(90.0f);   // 90 degrees/sec for the rectangle
 float speed3 = glm::radians(270.0f);  // 270 degrees/sec for the rectangle
 float speed4 = glm::radians(180.0f); // 180 degrees/sec for the  rectangle
 
+// particles: updated and drawn by the GPU, the CPU cost per frame does not depend on the count
+ShaderManager* shaders = NULL;
+GpuParticles* particles = NULL;
+bool particlesEnabled = true;
+float lastTime = 0.0f;
+
 int main()
 {
     window = glAllInit();
 
     globalShader = new Shader("4.3.transform.vs", "4.3.transform.fs");
 
+    // the particle programs compile in the background; the particles appear once they are ready
+    shaders = new ShaderManager(window);
+    particles = new GpuParticles(shaders->submitFeedback("particle_update.vs", GpuParticles::feedbackVaryings()),
+                                 shaders->submit("particle.vs", "particle.fs"), VBO);
+    particles->resize(1 << 16);
+    cout << "PARTICLES: " << particles->count << endl;
+
     // render loop
     while (!glfwWindowShouldClose(window)) {
         render();
         glfwPollEvents();
     }
 
+    delete particles;
+    delete shaders;
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
 
@@ -106,6 +128,7 @@ void render()
 {
     float currentTime = glfwGetTime();
     glm::mat4 transform;
+    shaders->poll();
 
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -146,6 +169,16 @@ void render()
     glBindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 
+    // Shader::use() and the draws above call GL directly
+    gl_state().invalidate();
+
+    // particles: advanced into the other buffer, then drawn from it
+    float dt = lastTime > 0.0f ? currentTime - lastTime : 0.0f;
+    lastTime = currentTime;
+    if (particlesEnabled) {
+        particles->update(dt, currentTime);
+        particles->draw();
+    }
 
     glfwSwapBuffers(window);
 }
@@ -162,4 +195,15 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
+    else if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        particlesEnabled = !particlesEnabled;
+        cout << "PARTICLES: " << (particlesEnabled ? "on" : "off") << endl;
+    }
+    else if ((key == GLFW_KEY_EQUAL || key == GLFW_KEY_MINUS) && action == GLFW_PRESS) {
+        unsigned int count = particles->count;
+        if (key == GLFW_KEY_EQUAL && count < GPU_PARTICLES_MAX) count *= 2;
+        else if (key == GLFW_KEY_MINUS && count > 1024) count /= 2;
+        particles->resize(count);
+        cout << "PARTICLES: " << count << endl;
+    }
 }
@@ -0,0 +1,22 @@
+#version 330 core
+// the rectangle of 4.3.transform.vs, instanced once per particle
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aOrbit;       // per instance
+layout (location = 2) in vec4 aState;
+
+out vec4 color;
+
+void main()
+{
+    // rotate(orbit angle) * translate(0.5 * sin(spiral), 0) * scale(size)
+    float c = cos(aOrbit.x), s = sin(aOrbit.x);
+    mat2 rotation = mat2(c, s, -s, c);
+    vec2 position = rotation * (vec2(0.5 * sin(aOrbit.z), 0.0) + aPos.xy * aState.z);
+    gl_Position = vec4(position, 0.0, 1.0);
+
+    // fade in and out over the life, hue from the seed
+    float t = aState.y > 0.0 ? aState.x / aState.y : 1.0;
+    float alpha = smoothstep(0.0, 0.1, t) * (1.0 - smoothstep(0.7, 1.0, t));
+    vec3 hue = 0.5 + 0.5 * cos(6.2831853 * (aState.w / 65536.0 + vec3(0.0, 0.33, 0.67)));
+    color = vec4(hue, alpha);
+}
@@ -0,0 +1,45 @@
+#version 330 core
+// one particle per vertex, written back with transform feedback (gpu_particles.h)
+layout (location = 0) in vec4 aOrbit;       // orbit angle, angular speed, spiral phase, spiral rate
+layout (location = 1) in vec4 aState;       // age, life (0: never spawned), size, seed
+
+out vec4 outOrbit;
+out vec4 outState;
+
+uniform float dt;
+uniform float time;
+
+// integer hash -> [0, 1)
+float Random(inout uint seed)
+{
+    seed ^= seed >> 16; seed *= 0x7feb352du;
+    seed ^= seed >> 15; seed *= 0x846ca68bu;
+    seed ^= seed >> 16;
+    return float(seed & 0xFFFFFFu) / 16777216.0;
+}
+
+void Spawn(uint seed, bool first)
+{
+    float life = 2.0 + 4.0 * Random(seed);
+    // like the yellow rectangle: 90 degrees/sec, spiral sin(t / 3), either direction
+    float direction = Random(seed) < 0.5 ? -1.0 : 1.0;
+    outOrbit = vec4(6.2831853 * Random(seed), direction * radians(45.0 + 90.0 * Random(seed)),
+                    6.2831853 * Random(seed), 1.0 / 3.0 + Random(seed) / 3.0);
+    // the first generation starts at a random age, so the pool does not respawn in lockstep
+    outState = vec4(first ? life * Random(seed) : 0.0, life, 0.3 + 0.7 * Random(seed), float(seed & 0xFFFFu));
+}
+
+void main()
+{
+    if (aState.y == 0.0) {
+        Spawn(uint(gl_VertexID) * 747796405u + 2891336453u, true);
+        return;
+    }
+    float age = aState.x + dt;
+    if (age >= aState.y) {
+        Spawn(uint(gl_VertexID) * 747796405u ^ floatBitsToUint(time) ^ uint(aState.w), false);
+        return;
+    }
+    outOrbit = vec4(aOrbit.x + aOrbit.y * dt, aOrbit.y, aOrbit.z + aOrbit.w * dt, aOrbit.w);
+    outState = vec4(age, aState.yzw);
+}
@@ -9,6 +9,8 @@
 #include <cmath>
 #include <shader.h>
 #include <cube.h>
+#include <gl_state.h>
+#include <multi_view.h>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
@@ -19,6 +21,7 @@ GLFWwindow *glAllInit();
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow *window, int key, int scancode, int action , int mods);
 void render();
+void setViews(const glm::mat4& orbitView);
 
 // Global variables
 GLFWwindow *window = NULL;
@@ -26,6 +29,13 @@ Shader *globalShader = NULL;
 unsigned int SCR_WIDTH = 600;
 unsigned int SCR_HEIGHT = 600;
 Cube *cube;
+glm::mat4 projection;
+
+// 'v' cycles: the orbiting camera alone, four views in one pass, four views one draw each
+enum ViewMode { VIEW_SINGLE = 0, VIEW_SINGLE_PASS = 1, VIEW_PER_VIEW = 2 };
+int viewMode = VIEW_SINGLE;
+Shader *multiViewShader = NULL;     // NULL without ARB_viewport_array
+MultiView *multiView = NULL;
 
 int main()
 {
@@ -36,12 +46,16 @@ int main()
     
     // projection matrix
     globalShader->use();
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+    projection = glm::perspective(glm::radians(45.0f),
                                   (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
     globalShader->setMat4("projection", projection);
     
     // cube initialization
     cube = new Cube();
+
+    multiView = new MultiView();
+    if (MultiView::supported()) multiViewShader = new Shader("multiview.vs", "5.3.fs", "multiview.gs");
+    else cout << "MULTIVIEW: ARB_viewport_array not supported, views are drawn one by one" << endl;
     
     // render loop
     // -----------
@@ -50,6 +64,8 @@ int main()
         glfwPollEvents();
     }
     
+    delete multiView;
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
@@ -124,16 +140,48 @@ void render() {
            glm::vec3(cubeX, 0.0f, cubeZ), // the position cube is at
            glm::vec3(0.0f, 1.0f, 0.0f));  // Up vector
 
-    // modeling transformation
-    globalShader->setMat4("model", model);
+    if (viewMode == VIEW_SINGLE) {
+        // modeling transformation
+        globalShader->setMat4("model", model);
 
-    globalShader->setMat4("view", view);
+        globalShader->setMat4("view", view);
 
-    cube->draw(globalShader);
+        cube->draw(globalShader);
+    }
+    else if (viewMode == VIEW_SINGLE_PASS && multiViewShader != NULL) {
+        setViews(view);
+        multiView->apply(multiViewShader->ID);
+        multiViewShader->setMat4("model", model);
+        cube->draw(multiViewShader);
+    }
+    else {
+        setViews(view);
+        globalShader->setMat4("model", model);
+        for (int i = 0; i < multiView->count; i++) {
+            const GLfloat* rect = multiView->viewRect(i);
+            glViewport((GLint)rect[0], (GLint)rect[1], (GLsizei)rect[2], (GLsizei)rect[3]);
+            globalShader->setMat4("view", multiView->viewMatrix(i));
+            globalShader->setMat4("projection", multiView->projectionMatrix(i));
+            cube->draw(globalShader);
+        }
+        globalShader->setMat4("projection", projection);
+    }
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    gl_state().invalidate();    // Shader::use() and Cube::draw() bypass the state cache
     
     glfwSwapBuffers(window);
 }
 
+// the orbiting camera top left, fixed top / front / side cameras in the other quarters
+void setViews(const glm::mat4& orbitView) {
+    float w = SCR_WIDTH / 2.0f, h = SCR_HEIGHT / 2.0f;
+    glm::vec3 target(0.0f, 0.0f, 0.0f);
+    multiView->setView(0, orbitView, projection, 0, h, w, h);
+    multiView->setView(1, glm::lookAt(glm::vec3(0.0f, 18.0f, 0.0f), target, glm::vec3(0.0f, 0.0f, -1.0f)), projection, w, h, w, h);
+    multiView->setView(2, glm::lookAt(glm::vec3(0.0f, 0.0f, 18.0f), target, glm::vec3(0.0f, 1.0f, 0.0f)), projection, 0, 0, w, h);
+    multiView->setView(3, glm::lookAt(glm::vec3(18.0f, 0.0f, 0.0f), target, glm::vec3(0.0f, 1.0f, 0.0f)), projection, w, 0, w, h);
+}
+
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -149,4 +197,11 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
+    else if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+        viewMode = (viewMode + 1) % 3;
+        if (viewMode == VIEW_SINGLE_PASS && multiViewShader == NULL) viewMode = VIEW_PER_VIEW;
+        if (viewMode == VIEW_SINGLE) cout << "MULTIVIEW: orbiting camera only" << endl;
+        else if (viewMode == VIEW_SINGLE_PASS) cout << "MULTIVIEW: 4 views in one pass, 1 draw call" << endl;
+        else cout << "MULTIVIEW: 4 views drawn one by one, 4 draw calls" << endl;
+    }
 }
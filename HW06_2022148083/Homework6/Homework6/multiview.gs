@@ -0,0 +1,39 @@
+#version 330 core
+#extension GL_ARB_viewport_array : require
+// every triangle once per view, routed to the view's viewport (multi_view.h)
+#define MAX_VIEWS 4
+
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 12) out;     // 3 * MAX_VIEWS
+
+layout (std140) uniform Views {
+    mat4 viewProjection[MAX_VIEWS];
+};
+uniform int viewCount;
+
+in vec4 vertexColor[];
+out vec4 toColor;
+
+void main()
+{
+    for (int v = 0; v < viewCount; v++) {
+        vec4 clip[3];
+        for (int i = 0; i < 3; i++) clip[i] = viewProjection[v] * gl_in[i].gl_Position;
+
+        // all three corners beyond the same clip plane: nothing of it is visible in this view
+        bool outside = false;
+        for (int axis = 0; axis < 3; axis++) {
+            outside = outside || (clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w);
+            outside = outside || (clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w);
+        }
+        if (outside) continue;
+
+        for (int i = 0; i < 3; i++) {
+            gl_Position = clip[i];
+            gl_ViewportIndex = v;
+            toColor = vertexColor[i];
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
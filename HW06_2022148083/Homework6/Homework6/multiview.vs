@@ -0,0 +1,15 @@
+#version 330 core
+// 5.3.vs up to world space; multiview.gs applies each view's projection * view
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec4 aColor;
+layout (location = 3) in vec2 aTexCoord;
+
+out vec4 vertexColor;
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = model * vec4(aPos, 1.0);
+    vertexColor = aColor;
+}
@@ -9,9 +9,13 @@
 
 #include <shader.h>
 #include <arcball.h>
+#include <hexprism.h>
+#include <frame_latency.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#include <gl_state.h>
+#include <virtual_texture.h>
 
 
 using namespace std;
@@ -23,9 +27,9 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void cursor_position_callback(GLFWwindow* window, double x, double y);
 void loadTexture();
+bool loadVirtualTexture();
 void render();
 void drawHexagonalPrism();
-void dynamic_vertice_mapping();
 
 // Global variables
 GLFWwindow* mainWindow = NULL;
@@ -41,24 +45,20 @@ glm::vec3 camUp(0.0f, 1.0f, 0.0f);
 float arcballSpeed = 0.3f;
 static Arcball modelArcBall(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
 
+// one frame in flight, input latched right before the arcball matrix is built
+FrameLatency frameLatency;
+
 // for texture
 static unsigned int texture; // Array of texture ids.
 
-// Hexagonal Prism vertices, normals, colors, and texture coordinates
-GLfloat hexVertices[72];
-GLfloat hexNormals[72];
-GLfloat hexColors[96];
-GLfloat hexTexCoords[48];
-
-// index array for glDrawElements()
-unsigned int hexIndices[36] = {
-    0, 1, 2, 0, 2, 3,
-    4, 5, 6, 4, 6, 7,
-    8, 9, 10, 8, 10, 11,
-    12, 13, 14, 12, 14, 15,
-    16, 17, 18, 16, 18, 19,
-    20, 21, 22, 20, 22, 23
-};
+// the map streams from a tile pyramid on disk through a fixed page cache;
+// the whole texture above is only the fallback when no pyramid can be baked
+VirtualTexture* virtualTexture = NULL;
+Shader* virtualShader = NULL;
+Shader* feedbackShader = NULL;
+
+// Hexagonal Prism: compile-time tables (primitives.h), optimized into one interleaved
+// mesh the first time drawHexagonalPrism() runs
 
 int main()
 {
@@ -76,16 +76,21 @@ int main()
     globalShader->setMat4("view", view);
 
     // load texture
-    loadTexture();
+    if (!loadVirtualTexture()) loadTexture();
 
-    // generate hexagonal prism vertices, normals, colors, and texture coordinates
-    dynamic_vertice_mapping();
 
     while (!glfwWindowShouldClose(mainWindow)) {
+        frameLatency.wait();
         render();
-        glfwPollEvents();
     }
 
+    frameLatency.release();
+    delete virtualTexture;      // stops the loader thread
+    if (texture != 0) gl_state().deleteTextures(1, &texture);
+    delete virtualShader;
+    delete feedbackShader;
+    delete globalShader;
+    memory_tracker().reportLeaks();
     glfwTerminate();
     return 0;
 }
@@ -165,28 +170,83 @@ void loadTexture() {
     glBindTexture(GL_TEXTURE_2D, texture);
     glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, image);
     glGenerateMipmap(GL_TEXTURE_2D);
+    if (image) MEMORY_TRACK_TEXTURE(texture, texture_bytes(format, width, height, 1, mip_levels(width, height)), MEMORY_TEXTURE, "world_map.jpg");
 
     // Free image memory
     stbi_image_free(image);
 }
 
+// world_map.vt is baked from world_map.jpg on the first run, and again when its format
+// or world_map.jpg changed
+bool loadVirtualTexture() {
+    if (!vt_current("world_map.jpg", "world_map.vt") && !vt_bake("world_map.jpg", "world_map.vt")) return false;
+    virtualTexture = new VirtualTexture("world_map.vt", 8);
+    if (!virtualTexture->valid) {
+        delete virtualTexture;
+        virtualTexture = NULL;
+        return false;
+    }
+
+    virtualShader = new Shader("global.vs", "virtual_texture.fs");
+    feedbackShader = new Shader("global.vs", "virtual_feedback.fs");
+    Shader* shaders[] = { virtualShader, feedbackShader };
+    for (int i = 0; i < 2; i++) {
+        shaders[i]->use();
+        shaders[i]->setMat4("projection", projection);
+        shaders[i]->setMat4("view", view);
+    }
+    gl_state().invalidate();
+    return true;
+}
+
 void render() {
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    // input as late as possible
+    frameLatency.latch();
     model = modelArcBall.createRotationMatrix();
 
-    globalShader->use();
-    globalShader->setMat4("model", model);
+    if (virtualTexture != NULL) {
+        // pages this view needs; read back and streamed from the next frame on
+        virtualTexture->beginFeedback(SCR_WIDTH, SCR_HEIGHT);
+        feedbackShader->use();
+        feedbackShader->setMat4("model", model);
+        virtualTexture->apply(feedbackShader->ID, 0, 1, true);
+        drawHexagonalPrism();
+        virtualTexture->endFeedback();
 
-    glBindTexture(GL_TEXTURE_2D, texture);
+        virtualTexture->update();
+
+        virtualShader->use();
+        virtualShader->setMat4("model", model);
+        virtualTexture->apply(virtualShader->ID, 0, 1, false);
+    }
+    else {
+        globalShader->use();
+        globalShader->setMat4("model", model);
+
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
 
     drawHexagonalPrism();
 
+    // Shader::use() and drawHexagonalPrism() bind through raw GL
+    gl_state().invalidate();
+
     glfwSwapBuffers(mainWindow);
+    frameLatency.presented();
 }
 
 void drawHexagonalPrism() {
+    // optimized once: welded, cache- and fetch-ordered, 16 bit indices (hexprism.h)
+    static HexPrismMesh hexMesh;
+    if (hexMesh.vertexCount == 0) {
+        hexMesh = hex_prism_mesh();
+        cout << "HEXPRISM: " << HexPrism::vertexCount << " -> " << hexMesh.vertexCount << " vertices, ACMR "
+             << hexMesh.acmrBefore << " -> " << hexMesh.acmrAfter << endl;
+    }
+
     // Bind VAO, VBO, EBO
     unsigned int VAO, VBO, EBO;
     glGenVertexArrays(1, &VAO);
@@ -196,33 +256,25 @@ void drawHexagonalPrism() {
     glBindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(hexVertices) + sizeof(hexNormals) + sizeof(hexColors) + sizeof(hexTexCoords), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(hexVertices), hexVertices);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(hexVertices), sizeof(hexNormals), hexNormals);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(hexVertices) + sizeof(hexNormals), sizeof(hexColors), hexColors);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(hexVertices) + sizeof(hexNormals) + sizeof(hexColors), sizeof(hexTexCoords), hexTexCoords);
+    glBufferData(GL_ARRAY_BUFFER, hexMesh.vertices.size() * sizeof(GLfloat), hexMesh.vertices.data(), GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(hexIndices), hexIndices, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, hexMesh.indices.size(), hexMesh.indices.data(), GL_STATIC_DRAW);
 
     // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, HEX_MESH_STRIDE * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
     // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(sizeof(hexVertices)));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, HEX_MESH_STRIDE * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    // Color attribute
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(sizeof(hexVertices) + sizeof(hexNormals)));
-    glEnableVertexAttribArray(2);
-
-    // Texture attribute
-    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)(sizeof(hexVertices) + sizeof(hexNormals) + sizeof(hexColors)));
+    // Texture attribute (attribute 2, the color, is not read by the shaders)
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, HEX_MESH_STRIDE * sizeof(float), (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(3);
 
     // Draw the hexagonal prism
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, (GLsizei)hexMesh.indices.count, hexMesh.indices.type, 0);
 
     // Clean up
     glDeleteBuffers(1, &VBO);
@@ -230,68 +282,6 @@ void drawHexagonalPrism() {
     glDeleteVertexArrays(1, &VAO);
 }
 
-void dynamic_vertice_mapping() {
-    for (int i = 0; i < 6; i++) {
-        hexVertices[i * 12] = sin(i * M_PI / 3);
-        hexVertices[i * 12 + 1] = -1; // y = -1
-        hexVertices[i * 12 + 2] = cos(i * M_PI / 3);
-        hexVertices[i * 12 + 3] = sin(i * M_PI / 3);
-        hexVertices[i * 12 + 4] = 1; // y = 1
-        hexVertices[i * 12 + 5] = cos(i * M_PI / 3);
-        hexVertices[i * 12 + 6] = sin((i + 1) * M_PI / 3);
-        hexVertices[i * 12 + 7] = 1;
-        hexVertices[i * 12 + 8] = cos((i + 1) * M_PI / 3);
-        hexVertices[i * 12 + 9] = sin((i + 1) * M_PI / 3);
-        hexVertices[i * 12 + 10] = -1;
-        hexVertices[i * 12 + 11] = cos((i + 1) * M_PI / 3);
-    }
-
-    for (int i = 0; i < 6; i++) {
-        hexNormals[i * 12] = 0;
-        hexNormals[i * 12 + 1] = 0;
-        hexNormals[i * 12 + 2] = -1;
-        hexNormals[i * 12 + 3] = 0;
-        hexNormals[i * 12 + 4] = 0;
-        hexNormals[i * 12 + 5] = 1;
-        hexNormals[i * 12 + 6] = 0;
-        hexNormals[i * 12 + 7] = 0;
-        hexNormals[i * 12 + 8] = 1;
-        hexNormals[i * 12 + 9] = 0;
-        hexNormals[i * 12 + 10] = 0;
-        hexNormals[i * 12 + 11] = -1;
-    }
-
-    for (int i = 0; i < 6; i++) {
-        hexColors[i * 16] = 1;
-        hexColors[i * 16 + 1] = 0;
-        hexColors[i * 16 + 2] = 0;
-        hexColors[i * 16 + 3] = 1;
-        hexColors[i * 16 + 4] = 1;
-        hexColors[i * 16 + 5] = 0;
-        hexColors[i * 16 + 6] = 0;
-        hexColors[i * 16 + 7] = 1;
-        hexColors[i * 16 + 8] = 0;
-        hexColors[i * 16 + 9] = 1;
-        hexColors[i * 16 + 10] = 0;
-        hexColors[i * 16 + 11] = 1;
-        hexColors[i * 16 + 12] = 0;
-        hexColors[i * 16 + 13] = 0;
-        hexColors[i * 16 + 14] = 1;
-        hexColors[i * 16 + 15] = 1;
-    }
-
-    for (int i = 0; i < 6; i++) {
-        hexTexCoords[i * 8] = i / 6.;
-        hexTexCoords[i * 8 + 1] = 1.;
-        hexTexCoords[i * 8 + 2] = i / 6.;
-        hexTexCoords[i * 8 + 3] = 0.;
-        hexTexCoords[i * 8 + 4] = (i + 1) / 6.;
-        hexTexCoords[i * 8 + 5] = 0.;
-        hexTexCoords[i * 8 + 6] = (i + 1) / 6.;
-        hexTexCoords[i * 8 + 7] = 1.;
-    }
-}
-
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
@@ -303,18 +293,32 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    frameLatency.input();
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
     else if (key == GLFW_KEY_R && action == GLFW_PRESS) {
         modelArcBall.init(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
     }
+    else if (key == GLFW_KEY_I && action == GLFW_PRESS) {
+        // input-to-present latency, reported every second
+        frameLatency.setMeasuring(!frameLatency.measuring);
+        cout << "LATENCY: measurement " << (frameLatency.measuring ? "on" : "off") << endl;
+    }
+    else if (key == GLFW_KEY_V && action == GLFW_PRESS && virtualTexture != NULL) {
+        cout << "VTEX: " << virtualTexture->residentPages() << " resident pages, " << virtualTexture->requests
+             << " requested, " << virtualTexture->uploads << " uploaded, " << virtualTexture->evictions
+             << " evicted, " << virtualTexture->dropped << " dropped (cache full)" << endl;
+        memory_tracker().report();
+    }
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+    frameLatency.input();
     modelArcBall.mouseButtonCallback(window, button, action, mods);
 }
 
 void cursor_position_callback(GLFWwindow* window, double x, double y) {
+    frameLatency.input();
     modelArcBall.cursorCallback(window, x, y);
 }
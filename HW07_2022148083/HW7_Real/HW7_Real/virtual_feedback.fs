@@ -0,0 +1,24 @@
+#version 330 core
+
+in vec4 toColor;
+in vec2 toTexCoord;
+layout (location = 0) out uvec4 Feedback;
+
+// the page (x, y, level) virtual_texture.fs would want; alpha 0 marks empty pixels
+uniform vec2 virtualScale;
+uniform float pages;
+uniform int levels;
+uniform float tileSize;
+uniform float lodBias;          // the feedback target is smaller than the window
+
+void main()
+{
+    vec2 uv = fract(toTexCoord) * virtualScale;
+    vec2 texels = toTexCoord * virtualScale * pages * tileSize;
+    vec2 dx = dFdx(texels), dy = dFdy(texels);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + lodBias;
+    int level = int(clamp(lod, 0.0, float(levels - 1)));
+
+    uvec2 page = uvec2(uv * (pages / exp2(float(level))));
+    Feedback = uvec4(page, uint(level), 1u);
+}
@@ -0,0 +1,34 @@
+#version 330 core
+
+in vec4 toColor;
+in vec2 toTexCoord;
+out vec4 FragColor;
+
+// virtual texture (see utils/virtual_texture.h)
+uniform sampler2D pageTable;    // per page: cache slot x, y and level of the finest resident ancestor
+uniform sampler2D pageCache;    // atlas of padded tiles
+uniform vec2 virtualScale;      // image size / page table size in texels
+uniform float pages;            // page table side at level 0
+uniform int levels;
+uniform float tileSize;
+uniform float border;
+uniform float cacheTexels;      // atlas side
+uniform float lodBias;
+
+void main()
+{
+    // repeat like the whole texture did; the level comes from the unwrapped coordinate
+    vec2 uv = fract(toTexCoord) * virtualScale;
+    vec2 texels = toTexCoord * virtualScale * pages * tileSize;
+    vec2 dx = dFdx(texels), dy = dFdy(texels);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + lodBias;
+    int level = int(clamp(lod, 0.0, float(levels - 1)));
+
+    ivec2 page = min(ivec2(uv * (pages / exp2(float(level)))), ivec2(int(pages) >> level) - 1);
+    vec3 entry = floor(texelFetch(pageTable, page, level).xyz * 255.0 + 0.5);
+
+    // position inside the page that is actually resident, then inside its cache slot
+    vec2 inPage = fract(uv * (pages / exp2(entry.z)));
+    vec2 cached = entry.xy * (tileSize + 2.0 * border) + border + inPage * tileSize;
+    FragColor = textureLod(pageCache, cached / cacheTexels, 0.0);
+}
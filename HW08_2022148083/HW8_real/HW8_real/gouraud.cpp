@@ -3,6 +3,7 @@
 //          : Mouse left button: arcball control for the object
 //          : Keyboard 'a': to switch between view and camera rotation modes
 //          : Keyboard 'r': to reset the arcball
+//          : Keyboard 'i': to toggle input-to-present latency measurement
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -19,6 +20,8 @@
 #include <shader.h>
 #include <cube.h>
 #include <arcball.h>
+#include <hexprism.h>
+#include <frame_latency.h>
 
 
 using namespace std;
@@ -32,7 +35,6 @@ void cursor_position_callback(GLFWwindow *window, double x, double y);
 void loadTexture();
 void render();
 void drawHexagonalPrism();
-void dynamic_vertice_mapping();
 
 // Global variables
 GLFWwindow *mainWindow = NULL;
@@ -50,6 +52,9 @@ static Arcball camArcBall(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true );
 static Arcball modelArcBall(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
 bool arcballCamRot = true;
 
+// one frame in flight, input latched right before the arcball matrices are built
+FrameLatency frameLatency;
+
 // for camera
 glm::vec3 cameraPos(0.0f, 3.0f, 7.0f);
 glm::vec3 camTarget(0.0f, 0.0f, 0.0f);
@@ -67,21 +72,8 @@ float specularPower = 64.0f;
 // for texture
 static unsigned int texture; // Array of texture ids.
 
-// Hexagonal Prism vertices, normals, colors, and texture coordinates
-GLfloat hexVertices[72];
-GLfloat hexNormals[72];
-GLfloat hexColors[96];
-GLfloat hexTexCoords[48];
-
-// index array for glDrawElements()
-unsigned int hexIndices[36] = {
-    0, 1, 2, 0, 2, 3,
-    4, 5, 6, 4, 6, 7,
-    8, 9, 10, 8, 10, 11,
-    12, 13, 14, 12, 14, 15,
-    16, 17, 18, 16, 18, 19,
-    20, 21, 22, 20, 22, 23
-};
+// Hexagonal Prism: compile-time tables (primitives.h), optimized into one interleaved
+// mesh the first time drawHexagonalPrism() runs
 
 
 int main()
@@ -118,15 +110,14 @@ int main()
     // load texture
     loadTexture();
 
-    // generate hexagonal prism vertices, normals, colors, and texture coordinates
-    dynamic_vertice_mapping();
     
     // render loop
     // -----------
     while (!glfwWindowShouldClose(mainWindow)) {
+        frameLatency.wait();
         render();
-        glfwPollEvents();
     }
+    frameLatency.release();
     
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -204,6 +195,9 @@ void loadTexture() {
 void render() {
     
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // input as late as possible
+    frameLatency.latch();
     
     view = glm::lookAt(cameraPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     view = view * camArcBall.createRotationMatrix();
@@ -228,9 +222,18 @@ void render() {
     cube->draw(lampShader);
     
     glfwSwapBuffers(mainWindow);
+    frameLatency.presented();
 }
 
 void drawHexagonalPrism() {
+    // optimized once: welded, cache- and fetch-ordered, 16 bit indices (hexprism.h)
+    static HexPrismMesh hexMesh;
+    if (hexMesh.vertexCount == 0) {
+        hexMesh = hex_prism_mesh();
+        cout << "HEXPRISM: " << HexPrism::vertexCount << " -> " << hexMesh.vertexCount << " vertices, ACMR "
+             << hexMesh.acmrBefore << " -> " << hexMesh.acmrAfter << endl;
+    }
+
     // Bind VAO, VBO, EBO
     unsigned int VAO, VBO, EBO;
     glGenVertexArrays(1, &VAO);
@@ -240,33 +243,25 @@ void drawHexagonalPrism() {
     glBindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(hexVertices) + sizeof(hexNormals) + sizeof(hexColors) + sizeof(hexTexCoords), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(hexVertices), hexVertices);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(hexVertices), sizeof(hexNormals), hexNormals);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(hexVertices) + sizeof(hexNormals), sizeof(hexColors), hexColors);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(hexVertices) + sizeof(hexNormals) + sizeof(hexColors), sizeof(hexTexCoords), hexTexCoords);
+    glBufferData(GL_ARRAY_BUFFER, hexMesh.vertices.size() * sizeof(GLfloat), hexMesh.vertices.data(), GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(hexIndices), hexIndices, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, hexMesh.indices.size(), hexMesh.indices.data(), GL_STATIC_DRAW);
 
     // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, HEX_MESH_STRIDE * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
     // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(sizeof(hexVertices)));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, HEX_MESH_STRIDE * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    // Color attribute
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(sizeof(hexVertices) + sizeof(hexNormals)));
-    glEnableVertexAttribArray(2);
-
-    // Texture attribute
-    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)(sizeof(hexVertices) + sizeof(hexNormals) + sizeof(hexColors)));
+    // Texture attribute (attribute 2, the color, is not read by the shaders)
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, HEX_MESH_STRIDE * sizeof(float), (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(3);
 
     // Draw the hexagonal prism
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, (GLsizei)hexMesh.indices.count, hexMesh.indices.type, 0);
 
     // Clean up
     glDeleteBuffers(1, &VBO);
@@ -274,68 +269,6 @@ void drawHexagonalPrism() {
     glDeleteVertexArrays(1, &VAO);
 }
 
-void dynamic_vertice_mapping() {
-    for (int i = 0; i < 6; i++) {
-        hexVertices[i * 12] = sin(i * M_PI / 3);
-        hexVertices[i * 12 + 1] = -1; // y = -1
-        hexVertices[i * 12 + 2] = cos(i * M_PI / 3);
-        hexVertices[i * 12 + 3] = sin(i * M_PI / 3);
-        hexVertices[i * 12 + 4] = 1; // y = 1
-        hexVertices[i * 12 + 5] = cos(i * M_PI / 3);
-        hexVertices[i * 12 + 6] = sin((i + 1) * M_PI / 3);
-        hexVertices[i * 12 + 7] = 1;
-        hexVertices[i * 12 + 8] = cos((i + 1) * M_PI / 3);
-        hexVertices[i * 12 + 9] = sin((i + 1) * M_PI / 3);
-        hexVertices[i * 12 + 10] = -1;
-        hexVertices[i * 12 + 11] = cos((i + 1) * M_PI / 3);
-    }
-
-    for (int i = 0; i < 6; i++) {
-        hexNormals[i * 12] = 0;
-        hexNormals[i * 12 + 1] = 0;
-        hexNormals[i * 12 + 2] = -1;
-        hexNormals[i * 12 + 3] = 0;
-        hexNormals[i * 12 + 4] = 0;
-        hexNormals[i * 12 + 5] = 1;
-        hexNormals[i * 12 + 6] = 0;
-        hexNormals[i * 12 + 7] = 0;
-        hexNormals[i * 12 + 8] = 1;
-        hexNormals[i * 12 + 9] = 0;
-        hexNormals[i * 12 + 10] = 0;
-        hexNormals[i * 12 + 11] = -1;
-    }
-
-    for (int i = 0; i < 6; i++) {
-        hexColors[i * 16] = 1;
-        hexColors[i * 16 + 1] = 0;
-        hexColors[i * 16 + 2] = 0;
-        hexColors[i * 16 + 3] = 1;
-        hexColors[i * 16 + 4] = 1;
-        hexColors[i * 16 + 5] = 0;
-        hexColors[i * 16 + 6] = 0;
-        hexColors[i * 16 + 7] = 1;
-        hexColors[i * 16 + 8] = 0;
-        hexColors[i * 16 + 9] = 1;
-        hexColors[i * 16 + 10] = 0;
-        hexColors[i * 16 + 11] = 1;
-        hexColors[i * 16 + 12] = 0;
-        hexColors[i * 16 + 13] = 0;
-        hexColors[i * 16 + 14] = 1;
-        hexColors[i * 16 + 15] = 1;
-    }
-
-    for (int i = 0; i < 6; i++) {
-        hexTexCoords[i * 8] = i / 6.;
-        hexTexCoords[i * 8 + 1] = 1.;
-        hexTexCoords[i * 8 + 2] = i / 6.;
-        hexTexCoords[i * 8 + 3] = 0.;
-        hexTexCoords[i * 8 + 4] = (i + 1) / 6.;
-        hexTexCoords[i * 8 + 5] = 0.;
-        hexTexCoords[i * 8 + 6] = (i + 1) / 6.;
-        hexTexCoords[i * 8 + 7] = 1.;
-    }
-}
-
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -348,6 +281,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 }
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    frameLatency.input();
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
@@ -364,9 +298,14 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
             cout << "ARCBALL: Model  rotation mode" << endl;
         }
     }
+    else if (key == GLFW_KEY_I && action == GLFW_PRESS) {
+        frameLatency.setMeasuring(!frameLatency.measuring);
+        cout << "LATENCY: measurement " << (frameLatency.measuring ? "on" : "off") << endl;
+    }
 }
 
 void mouse_button_callback(GLFWwindow *window, int button, int action, int mods) {
+    frameLatency.input();
     if (arcballCamRot)
         camArcBall.mouseButtonCallback( window, button, action, mods );
     else
@@ -374,6 +313,7 @@ void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
 }
 
 void cursor_position_callback(GLFWwindow *window, double x, double y) {
+    frameLatency.input();
     if (arcballCamRot)
         camArcBall.cursorCallback( window, x, y );
     else
@@ -2,10 +2,11 @@
 out vec4 FragColor;
 
 struct Material {
-    sampler2D diffuse;
-    sampler2D specular;
+    sampler2DArray maps;    // material texture pool (material_pool.h), one layer per map
+    int diffuseLayer;
+    int specularLayer;
     float shininess;
-}; 
+};
 
 struct DirLight {
     vec3 direction;
@@ -32,37 +33,56 @@ struct PointLight {
 };
 
 #define NR_POINT_LIGHTS 1
+#define NR_CASCADES 3
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+in float ViewDepth;
 
 uniform vec3 viewPos;
 uniform DirLight dirLight;
 uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform Material material;
 
+// shadow atlas (see shadow_maps.h): cascades of dirLight, 6 cube faces per point light
+uniform bool shadowsEnabled;
+uniform sampler2DShadow shadowAtlas;
+uniform vec2 shadowTexelSize;
+uniform mat4 cascadeMatrices[NR_CASCADES];
+uniform vec4 cascadeRects[NR_CASCADES];
+uniform float cascadeSplits[NR_CASCADES];
+uniform mat4 pointShadowMatrices[NR_POINT_LIGHTS * 6];
+uniform vec4 pointShadowRects[NR_POINT_LIGHTS * 6];
+
+#include "lod_dither.glsl"
+
 // function prototypes
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, float shadow);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, float shadow);
+float SampleShadow(mat4 atlasMatrix, vec4 rect, vec3 pos);
+float DirShadow(vec3 normal);
+float PointShadow(int light, vec3 normal);
 
 void main()
 {    
+    if (LodDiscard()) discard;
+
     // properties
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
     
     // directional lighting
-    vec3 result = CalcDirLight(dirLight, norm, viewDir);
+    vec3 result = CalcDirLight(dirLight, norm, viewDir, DirShadow(norm));
     // point lights
     for(int i = 0; i < NR_POINT_LIGHTS; i++)
-        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
+        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir, PointShadow(i, norm));
     
     FragColor = vec4(result, 1.0);
 }
 
 // calculates the color when using a directional light.
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, float shadow)
 {
     vec3 lightDir = normalize(-light.direction);
     // diffuse shading
@@ -71,14 +91,14 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    return (ambient + diffuse + specular);
+    vec3 ambient = light.ambient * vec3(texture(material.maps, vec3(TexCoords, material.diffuseLayer)));
+    vec3 diffuse = light.diffuse * diff * vec3(texture(material.maps, vec3(TexCoords, material.diffuseLayer)));
+    vec3 specular = light.specular * spec * vec3(texture(material.maps, vec3(TexCoords, material.specularLayer)));
+    return (ambient + shadow * (diffuse + specular));
 }
 
 // calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, float shadow)
 {
     vec3 lightDir = normalize(light.position - fragPos);
     // diffuse shading
@@ -90,12 +110,56 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * vec3(texture(material.maps, vec3(TexCoords, material.diffuseLayer)));
+    vec3 diffuse = light.diffuse * diff * vec3(texture(material.maps, vec3(TexCoords, material.diffuseLayer)));
+    vec3 specular = light.specular * spec * vec3(texture(material.maps, vec3(TexCoords, material.specularLayer)));
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
-    return (ambient + diffuse + specular);
+    return (ambient + shadow * (diffuse + specular));
+}
+
+// 3x3 PCF inside one atlas tile; 1.0 = fully lit
+float SampleShadow(mat4 atlasMatrix, vec4 rect, vec3 pos)
+{
+    vec4 p = atlasMatrix * vec4(pos, 1.0);
+    p.xyz /= p.w;
+    if (p.z >= 1.0)
+        return 1.0;
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x++)
+        for(int y = -1; y <= 1; y++)
+        {
+            vec2 uv = clamp(p.xy + vec2(x, y) * shadowTexelSize, rect.xy, rect.zw);
+            lit += texture(shadowAtlas, vec3(uv, p.z));
+        }
+    return lit / 9.0;
+}
+
+float DirShadow(vec3 normal)
+{
+    if (!shadowsEnabled)
+        return 1.0;
+    // normal offset against acne on surfaces grazing the light
+    vec3 pos = FragPos + normal * 0.02;
+    for(int i = 0; i < NR_CASCADES; i++)
+        if (ViewDepth < cascadeSplits[i])
+            return SampleShadow(cascadeMatrices[i], cascadeRects[i], pos);
+    return 1.0;
+}
+
+float PointShadow(int light, vec3 normal)
+{
+    if (!shadowsEnabled)
+        return 1.0;
+    // cube face by major axis: +X, -X, +Y, -Y, +Z, -Z
+    vec3 d = FragPos - pointLights[light].position;
+    vec3 a = abs(d);
+    int face;
+    if (a.x >= a.y && a.x >= a.z) face = d.x > 0.0 ? 0 : 1;
+    else if (a.y >= a.z) face = d.y > 0.0 ? 2 : 3;
+    else face = d.z > 0.0 ? 4 : 5;
+    int i = light * 6 + face;
+    return SampleShadow(pointShadowMatrices[i], pointShadowRects[i], FragPos + normal * 0.02);
 }
 
@@ -0,0 +1,32 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 3) in vec2 aTexCoords;
+// 0, 1, 2, ... with divisor 1: equals the command's baseInstance, i.e. its compacted index
+layout (location = 4) in uint aDrawIndex;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+out float ViewDepth;
+
+// model matrices written by cull_instances.comp
+layout (std430, binding = 0) readonly buffer DrawData {
+    mat4 models[];
+};
+uniform mat4 view;
+uniform mat4 projection;
+
+// same as 6.multiple_lights.vs, with the model matrix of the culled draw
+invariant gl_Position;
+
+void main()
+{
+    mat4 model = models[aDrawIndex];
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    TexCoords = aTexCoords;
+    ViewDepth = -(view * vec4(FragPos, 1.0)).z;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
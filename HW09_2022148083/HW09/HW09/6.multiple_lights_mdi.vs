@@ -0,0 +1,31 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 3) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+out float ViewDepth;
+
+// one model matrix per command of the glMultiDrawElementsIndirect (IndirectBatch)
+layout (std430, binding = 0) readonly buffer DrawData {
+    mat4 models[];
+};
+uniform mat4 view;
+uniform mat4 projection;
+
+// same as 6.multiple_lights.vs, with the model matrix of draw gl_DrawIDARB
+invariant gl_Position;
+
+void main()
+{
+    mat4 model = models[gl_DrawIDARB];
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    TexCoords = aTexCoords;
+    ViewDepth = -(view * vec4(FragPos, 1.0)).z;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
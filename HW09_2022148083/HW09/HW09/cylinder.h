@@ -1,29 +1,77 @@
 #ifndef CYLINDER_H
 #define CYLINDER_H
 
-#include "shader.h"
+#include <shader_manager.h>
+#include <gl_state.h>
+#include <meshopt.h>
+#include <dynamic_buffer.h>
+#include <vertex_format.h>
+#include <geometry_arena.h>
+#include <quantize.h>
+#include <primitives.h>
+#include <vector>
+#include <iostream>
 #define M_PI 3.14159265358979323846
 
+// 1: 16 byte quantized vertices (snorm16 position, 10:10:10:2 normal, half texcoord)
+// 0: 32 byte float vertices
+#define CYLINDER_QUANTIZED 1
+
+// 4 vertices per segment before welding: 65532 vertices, within the 0xFFFF that
+// pack_indices() and the arena store as 16 bit indices
+#define CYLINDER_MAX_SEGMENTS 16383
+static_assert(CYLINDER_MAX_SEGMENTS * 4 <= 0xFFFF, "cylinder indices must fit 16 bits");
+
 class Cylinder {
 public:
-    GLfloat cylinderVertices[12*48];
-    GLfloat cylinderNormals[12*48];
-    GLfloat cylinderColors[12*48];
-    GLfloat cylinderTexCoords[8*48];
-    unsigned int cylinderIndices[6*48];
+    // sized for n segments by dynamic_vertice_mapping() / dynamic_index_mapping()
+    std::vector<GLfloat> cylinderVertices;
+    std::vector<GLfloat> cylinderNormals;
+    std::vector<GLfloat> cylinderColors;
+    std::vector<GLfloat> cylinderTexCoords;
+    std::vector<unsigned int> cylinderIndices;
 
-    unsigned int VAO, VBO, EBO;
-    
-    unsigned int vSize = sizeof(cylinderVertices);
-    unsigned int nSize = sizeof(cylinderNormals);
-    unsigned int cSize = sizeof(cylinderColors);
-    unsigned int tSize = sizeof(cylinderTexCoords);
+    // created once; render() updates the buffers in place.
+    // With an arena the mesh is a range of the arena's buffers and VAO is the arena's.
+    unsigned int VAO = 0;
+    DynamicBuffer VBO{ GL_ARRAY_BUFFER, "cylinder vertices" };
+    DynamicBuffer EBO{ GL_ELEMENT_ARRAY_BUFFER, "cylinder indices" };
+
+    // only what 6.multiple_lights.vs reads: colors stay on the CPU side
+#if CYLINDER_QUANTIZED
+    typedef VertexFormat<PositionSnorm16, Normal1010102, TexCoordHalf2> Format;
+#else
+    typedef VertexFormat<Position3f, Normal3f, TexCoord2f> Format;
+#endif
+    typedef Format::Vertex Vertex;
+
+    // bounding range of the snorm16 positions
+    PositionQuantization positionRange;
+
+    // optimized mesh actually uploaded by initBuffers()
+    unsigned int vertexCount = 0;
+    unsigned int indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    size_t indexOffset = 0;         // bytes, non-zero only inside an arena
+    GLint baseVertex = 0;
+    float acmrBefore = 0.0f, acmrAfter = 0.0f;
 
     int n;
-    bool flat_shading;
+    bool flat_shading = false;
 
 
     void dynamic_vertice_mapping(int n = 48, bool flat_shading = false) {
+        if (!fixedShape(n, flat_shading))
+            side_mapping(n, flat_shading, cylinderVertices, cylinderNormals, cylinderColors, cylinderTexCoords);
+    }
+
+    // the runtime generator for any n; the CylinderShape tables are checked against it
+    static void side_mapping(int n, bool flat_shading, std::vector<GLfloat>& cylinderVertices, std::vector<GLfloat>& cylinderNormals,
+                             std::vector<GLfloat>& cylinderColors, std::vector<GLfloat>& cylinderTexCoords) {
+        cylinderVertices.resize(12 * n);
+        cylinderNormals.resize(12 * n);
+        cylinderColors.resize(12 * n);
+        cylinderTexCoords.resize(8 * n);
 
         float angle = 2 * M_PI / n;
         for (int i = 0; i < n; i++) {
@@ -44,18 +92,21 @@ public:
         
 
         for (int i = 0; i < n; i++) {
-            cylinderNormals[i * 12] = sin(i * angle);
+            // flat shading: every vertex of a side face gets the face normal
+            float a0 = flat_shading ? (i + 0.5f) * angle : i * angle;
+            float a1 = flat_shading ? (i + 0.5f) * angle : (i + 1) * angle;
+            cylinderNormals[i * 12] = sin(a0);
             cylinderNormals[i * 12 + 1] = 0;
-            cylinderNormals[i * 12 + 2] = cos(i * angle);
-            cylinderNormals[i * 12 + 3] = sin(i * angle);
+            cylinderNormals[i * 12 + 2] = cos(a0);
+            cylinderNormals[i * 12 + 3] = sin(a0);
             cylinderNormals[i * 12 + 4] = 0;
-            cylinderNormals[i * 12 + 5] = cos(i * angle);
-            cylinderNormals[i * 12 + 6] = sin((i + 1) * angle);
+            cylinderNormals[i * 12 + 5] = cos(a0);
+            cylinderNormals[i * 12 + 6] = sin(a1);
             cylinderNormals[i * 12 + 7] = 0;
-            cylinderNormals[i * 12 + 8] = cos((i + 1) * angle);
-            cylinderNormals[i * 12 + 9] = sin((i + 1) * angle);
+            cylinderNormals[i * 12 + 8] = cos(a1);
+            cylinderNormals[i * 12 + 9] = sin(a1);
             cylinderNormals[i * 12 + 10] = 0;
-            cylinderNormals[i * 12 + 11] = cos((i + 1) * angle);
+            cylinderNormals[i * 12 + 11] = cos(a1);
         }
         
         
@@ -81,21 +132,47 @@ public:
 
         }
 
-        // texture coord array
+        // texture coord array: u runs once around the side, so neighbouring quads share
+        // their edge vertices (welded by optimizeMesh()); only the u = 0 / u = 1 seam is split
         for (int i = 0; i < n; i++) {
 
-            cylinderTexCoords[i * 8] = 1;
-            cylinderTexCoords[i * 8 + 1] = 1;
-            cylinderTexCoords[i * 8 + 2] = 0;
+            cylinderTexCoords[i * 8] = (float)i / n;
+            cylinderTexCoords[i * 8 + 1] = 0;
+            cylinderTexCoords[i * 8 + 2] = (float)i / n;
             cylinderTexCoords[i * 8 + 3] = 1;
-            cylinderTexCoords[i * 8 + 4] = 0;
-            cylinderTexCoords[i * 8 + 5] = 0;
-            cylinderTexCoords[i * 8 + 6] = 1;
+            cylinderTexCoords[i * 8 + 4] = (float)(i + 1) / n;
+            cylinderTexCoords[i * 8 + 5] = 1;
+            cylinderTexCoords[i * 8 + 6] = (float)(i + 1) / n;
             cylinderTexCoords[i * 8 + 7] = 0;
         }
     }
 
+    // the default level chain (48, 24, 12, 6 segments) is copied from compile-time tables
+    bool fixedShape(int n, bool flat_shading) {
+        switch (n) {
+        case 48: return flat_shading ? assignShape<48, SHADING_FLAT>() : assignShape<48, SHADING_SMOOTH>();
+        case 24: return flat_shading ? assignShape<24, SHADING_FLAT>() : assignShape<24, SHADING_SMOOTH>();
+        case 12: return flat_shading ? assignShape<12, SHADING_FLAT>() : assignShape<12, SHADING_SMOOTH>();
+        case 6: return flat_shading ? assignShape<6, SHADING_FLAT>() : assignShape<6, SHADING_SMOOTH>();
+        }
+        return false;
+    }
+
+    template <int N, Shading S> bool assignShape() {
+        const CylinderTables<N>& tables = CylinderShape<N, S>::tables;
+        cylinderVertices.assign(tables.vertices, tables.vertices + 12 * N);
+        cylinderNormals.assign(tables.normals, tables.normals + 12 * N);
+        cylinderColors.assign(tables.colors, tables.colors + 12 * N);
+        cylinderTexCoords.assign(tables.texCoords, tables.texCoords + 8 * N);
+        return true;
+    }
+
     void dynamic_index_mapping(int n) {
+        index_mapping(n, cylinderIndices);
+    }
+
+    static void index_mapping(int n, std::vector<unsigned int>& cylinderIndices) {
+        cylinderIndices.resize(6 * n);
 
         for (int i = 0; i < n; i++) {
             cylinderIndices[i * 6] = i * 4;
@@ -107,57 +184,107 @@ public:
         }
     }
 
-    Cylinder(int n = 48) {
+    GeometryArena<Format>* arena;
+    MeshRange range;
+
+    Cylinder(int n = 48, GeometryArena<Format>* arena = NULL) {
         this->n = n;
+        this->arena = arena;
         dynamic_vertice_mapping(n, false);
         dynamic_index_mapping(n);
         initBuffers();
     }
 
-    void initBuffers() {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+    // pack the generated arrays into Format, weld duplicates, reorder for the vertex cache and fetch locality.
+    // Smooth shading welds the 4n quad corners to 2n + 2 vertices; flat shading has a normal
+    // per face, so its corners stay apart and only the triangle order changes.
+    void optimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+        vertices.resize(n * 4);
+        positionRange = PositionQuantization(cylinderVertices.data(), n * 4);
+        for (int v = 0; v < n * 4; v++) {
+            glm::vec3 position(cylinderVertices[v * 3], cylinderVertices[v * 3 + 1], cylinderVertices[v * 3 + 2]);
+            glm::vec3 normal(cylinderNormals[v * 3], cylinderNormals[v * 3 + 1], cylinderNormals[v * 3 + 2]);
+            glm::vec2 texCoord(cylinderTexCoords[v * 2], cylinderTexCoords[v * 2 + 1]);
+#if CYLINDER_QUANTIZED
+            vertices[v].set<PositionSnorm16>(positionRange.encode(position));
+            vertices[v].set<Normal1010102>(pack_snorm_1010102(normal));
+            vertices[v].set<TexCoordHalf2>(pack_half2(texCoord));
+#else
+            vertices[v].set<Position3f>(position);
+            vertices[v].set<Normal3f>(normal);
+            vertices[v].set<TexCoord2f>(texCoord);
+#endif
+        }
+        indices.assign(cylinderIndices.begin(), cylinderIndices.begin() + n * 6);
 
-        glBindVertexArray(VAO);
+        acmrBefore = average_cache_miss_ratio(indices, n * 4);
+        size_t welded = weld_vertices(vertices, 1, indices);
+        optimize_vertex_cache(indices, welded);
+        optimize_vertex_fetch(vertices, 1, indices);
+        vertexCount = (unsigned int)vertices.size();
+        acmrAfter = average_cache_miss_ratio(indices, vertexCount);
+    }
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vSize + nSize + cSize + tSize, NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, vSize, cylinderVertices);
-        glBufferSubData(GL_ARRAY_BUFFER, vSize, nSize, cylinderNormals);
-        glBufferSubData(GL_ARRAY_BUFFER, vSize + nSize, cSize, cylinderColors);
-        glBufferSubData(GL_ARRAY_BUFFER, vSize + nSize + cSize, tSize, cylinderTexCoords);
+    void initBuffers() {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        optimizeMesh(vertices, indices);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cylinderIndices), cylinderIndices, GL_STATIC_DRAW);
+        if (arena != NULL) {
+            // the arena keeps one index type for every mesh (16 bit in HW09)
+            range = range.vertexCount > 0 ? arena->update(range, vertices, indices) : arena->allocate(vertices, indices);
+            arena->upload();
+            VAO = arena->VAO;
+            indexCount = range.indexCount;
+            indexType = arena->indexType;
+            indexOffset = range.firstIndex * arena->indexSize();
+            baseVertex = (GLint)range.firstVertex;
+            return;
+        }
 
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-        glEnableVertexAttribArray(0);
+        IndexData packed = pack_indices(indices, vertexCount);
+        indexCount = (unsigned int)packed.count;
+        indexType = packed.type;
 
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)(vSize));
-        glEnableVertexAttribArray(1);
+        bool created = (VAO == 0);
+        if (created) VAO = gl_names().vertexArray();
 
-        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*)(vSize + nSize));
-        glEnableVertexAttribArray(2);
+        gl_state().bindVertexArray(VAO);
 
-        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)(vSize + nSize + cSize));
-        glEnableVertexAttribArray(3);
+        // only the changed range is uploaded; storage grows x2 when the mesh outgrows it
+        VBO.upload(vertices.data(), vertices.size() * sizeof(Vertex));
+        EBO.upload(packed.data(), packed.size());
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        if (created) Format::setup();
     }
     
-    void draw(Shader *shader) {
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, n * 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    // multiply into the model matrix: restores the quantized position range with a
+    // translation and a uniform scale, so the normal matrix stays unskewed
+    glm::mat4 decodeMatrix() {
+#if CYLINDER_QUANTIZED
+        return positionRange.decodeMatrix();
+#else
+        return glm::mat4(1.0f);
+#endif
+    }
+
+    // the VAO stays bound: the next draw of this mesh binds nothing
+    void draw(ShaderProgram *shader) {
+        gl_state().bindVertexArray(VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, indexType, (void*)indexOffset, baseVertex);
     }
     
+    // regenerate after a change of n or flat_shading, reusing the GL objects
     void render() {
         dynamic_vertice_mapping(n, flat_shading);
         dynamic_index_mapping(n);
         initBuffers();
     }
+
+    ~Cylinder() {
+        if (arena != NULL) arena->release(range);
+        else if (VAO != 0) gl_state().deleteVertexArrays(1, &VAO);
+    }
 };
 
 #endif
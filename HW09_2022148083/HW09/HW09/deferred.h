@@ -0,0 +1,204 @@
+#ifndef DEFERRED_H
+#define DEFERRED_H
+
+// Deferred shading path.
+//      geometry pass: the scene writes a compact G-buffer (12 bytes per pixel)
+//          normal     GL_RGB10_A2   world normal * 0.5 + 0.5
+//          albedoSpec GL_RGBA8      rgb: material.diffuse, a: material.specular
+//          depth      GL_DEPTH_COMPONENT24, positions are rebuilt from it
+//      lighting pass: fullscreen triangles, additive
+//          dirLight   every pixel once; also copies the G-buffer depth into the window
+//          pointLight scissored to the screen rectangle of the light volume (the sphere
+//                     where attenuation drops below POINT_LIGHT_CUTOFF)
+//
+// Lighting cost scales with visible pixels x lights touching them, not with overdraw.
+// The scene may cover only the lower left viewWidth x viewHeight of the G-buffer
+// (dynamic resolution): the G-buffer keeps the window size, the lighting pass samples
+// that part and writes the same rectangle of its output framebuffer.
+
+#include <shader_manager.h>
+#include <gl_state.h>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <cmath>
+
+#define POINT_LIGHT_CUTOFF (5.0f / 256.0f)
+
+// distance at which intensity * attenuation falls below POINT_LIGHT_CUTOFF
+inline float point_light_radius(float constant, float linear, float quadratic, float intensity) {
+    float c = constant - intensity / POINT_LIGHT_CUTOFF;
+    if (quadratic <= 0.0f) return linear > 0.0f ? -c / linear : 1e30f;
+    return (-linear + sqrtf(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+}
+
+// screen rectangle (x, y, width, height) covered by a sphere; false if it is off screen
+inline bool sphere_scissor_rect(const glm::mat4& viewProj, const glm::vec3& center, float radius,
+                                int screenWidth, int screenHeight, int rect[4]) {
+    glm::vec2 lo(1.0f), hi(-1.0f);
+    for (int k = 0; k < 8; k++) {
+        glm::vec3 corner = center + glm::vec3(k & 1 ? radius : -radius, k & 2 ? radius : -radius, k & 4 ? radius : -radius);
+        glm::vec4 clip = viewProj * glm::vec4(corner, 1.0f);
+        if (clip.w <= 0.0f) {
+            // the volume crosses the camera plane: whole screen
+            lo = glm::vec2(-1.0f);
+            hi = glm::vec2(1.0f);
+            break;
+        }
+        glm::vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+        lo = glm::min(lo, ndc);
+        hi = glm::max(hi, ndc);
+    }
+    lo = glm::max(lo, glm::vec2(-1.0f));
+    hi = glm::min(hi, glm::vec2(1.0f));
+    if (lo.x >= hi.x || lo.y >= hi.y) return false;
+
+    rect[0] = (int)floorf((lo.x * 0.5f + 0.5f) * screenWidth);
+    rect[1] = (int)floorf((lo.y * 0.5f + 0.5f) * screenHeight);
+    rect[2] = (int)ceilf((hi.x * 0.5f + 0.5f) * screenWidth) - rect[0];
+    rect[3] = (int)ceilf((hi.y * 0.5f + 0.5f) * screenHeight) - rect[1];
+    return true;
+}
+
+class DeferredRenderer {
+public:
+    unsigned int FBO = 0;
+    unsigned int normalTex = 0, albedoSpecTex = 0, depthTex = 0;
+    unsigned int VAO = 0;                   // empty: the fullscreen triangle comes from gl_VertexID
+    int width = 0, height = 0;
+    int viewWidth = 0, viewHeight = 0;      // part the scene covers
+    ShaderProgram* geometryShader;
+    ShaderProgram* lightShader;
+
+    // statistics of the last frame
+    unsigned int pointLightsDrawn = 0;
+    unsigned int pointLightsCulled = 0;
+
+    DeferredRenderer(ShaderProgram* geometryShader, ShaderProgram* lightShader) {
+        this->geometryShader = geometryShader;
+        this->lightShader = lightShader;
+        glGenVertexArrays(1, &VAO);
+        glGenFramebuffers(1, &FBO);
+    }
+
+    ~DeferredRenderer() {
+        releaseTargets();
+        gl_state().deleteFramebuffers(1, &FBO);
+        gl_state().deleteVertexArrays(1, &VAO);
+    }
+
+    // (re)create the G-buffer when the window size changed
+    void resize(int width, int height) {
+        if (width == this->width && height == this->height) return;
+        releaseTargets();
+        this->width = width;
+        this->height = height;
+
+        normalTex = createTarget(GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, "g-buffer normal");
+        albedoSpecTex = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, "g-buffer albedo/specular");
+        depthTex = createTarget(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT, "g-buffer depth");
+
+        gl_state().bindFramebuffer(FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, normalTex, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, albedoSpecTex, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTex, 0);
+        GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, drawBuffers);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "DEFERRED: G-buffer framebuffer is incomplete" << std::endl;
+    }
+
+    // bind and clear the G-buffer; the caller draws the scene with geometryShader
+    void beginGeometry(int screenWidth, int screenHeight) {
+        beginGeometry(screenWidth, screenHeight, screenWidth, screenHeight);
+    }
+
+    // the viewport is already viewWidth x viewHeight
+    void beginGeometry(int screenWidth, int screenHeight, int viewWidth, int viewHeight) {
+        resize(screenWidth, screenHeight);
+        this->viewWidth = viewWidth;
+        this->viewHeight = viewHeight;
+        gl_state().bindFramebuffer(FBO);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        geometryShader->use();
+    }
+
+    // back to the window (or output); lightShader is in use with the G-buffer bound to units 3-5
+    void beginLighting(const glm::mat4& projection, const glm::mat4& view, unsigned int output = 0) {
+        gl_state().bindFramebuffer(output);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        lightShader->use();
+        lightShader->setInt("gNormal", 3);
+        lightShader->setInt("gAlbedoSpec", 4);
+        lightShader->setInt("gDepth", 5);
+        lightShader->setVec2("uvScale", (float)viewWidth / width, (float)viewHeight / height);
+        lightShader->setMat4("view", view);
+        lightShader->setMat4("invViewProj", glm::inverse(projection * view));
+        gl_state().bindTextureUnit(3, GL_TEXTURE_2D, normalTex);
+        gl_state().bindTextureUnit(4, GL_TEXTURE_2D, albedoSpecTex);
+        gl_state().bindTextureUnit(5, GL_TEXTURE_2D, depthTex);
+        gl_state().bindVertexArray(VAO);
+        pointLightsDrawn = pointLightsCulled = 0;
+    }
+
+    // ambient + directional light on every pixel; writes the G-buffer depth for later forward draws
+    void directionalPass() {
+        gl_state().depthFunc(GL_ALWAYS);
+        lightShader->setInt("lightPass", 0);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        gl_state().depthFunc(GL_LESS);
+
+        // point lights add on top without touching depth
+        gl_state().depthMask(GL_FALSE);
+        gl_state().disable(GL_DEPTH_TEST);
+        gl_state().enable(GL_BLEND);
+        gl_state().blendFunc(GL_ONE, GL_ONE);
+        gl_state().enable(GL_SCISSOR_TEST);
+    }
+
+    // shade only the pixels inside the screen rectangle of the light volume
+    void pointLightPass(int index, const glm::vec3& position, float radius, const glm::mat4& viewProj) {
+        int rect[4];
+        if (!sphere_scissor_rect(viewProj, position, radius, viewWidth, viewHeight, rect)) {
+            pointLightsCulled++;
+            return;
+        }
+        gl_state().scissor(rect[0], rect[1], rect[2], rect[3]);
+        lightShader->setInt("lightPass", 1);
+        lightShader->setInt("lightIndex", index);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        pointLightsDrawn++;
+    }
+
+    void endLighting() {
+        gl_state().disable(GL_SCISSOR_TEST);
+        gl_state().disable(GL_BLEND);
+        gl_state().enable(GL_DEPTH_TEST);
+        gl_state().depthMask(GL_TRUE);
+    }
+
+private:
+    unsigned int createTarget(GLenum internalFormat, GLenum format, GLenum type, const char* tag) {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        gl_state().bindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+        MEMORY_TRACK_TEXTURE(texture, texture_bytes(internalFormat, width, height), MEMORY_RENDER_TARGET, tag);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+
+    void releaseTargets() {
+        unsigned int textures[3] = { normalTex, albedoSpecTex, depthTex };
+        if (normalTex != 0) gl_state().deleteTextures(3, textures);
+        normalTex = albedoSpecTex = depthTex = 0;
+    }
+
+    DeferredRenderer(const DeferredRenderer&);
+    DeferredRenderer& operator=(const DeferredRenderer&);
+};
+
+#endif
@@ -0,0 +1,28 @@
+#version 330 core
+// G-buffer pass of the deferred path (vertex shader: 6.multiple_lights.vs)
+layout (location = 0) out vec4 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+
+struct Material {
+    sampler2DArray maps;    // material texture pool (material_pool.h), one layer per map
+    int diffuseLayer;
+    int specularLayer;
+    float shininess;
+};
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+in float ViewDepth;
+
+uniform Material material;
+
+#include "lod_dither.glsl"
+
+void main()
+{
+    if (LodDiscard()) discard;
+    gNormal = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);
+    gAlbedoSpec.rgb = texture(material.maps, vec3(TexCoords, material.diffuseLayer)).rgb;
+    gAlbedoSpec.a = texture(material.maps, vec3(TexCoords, material.specularLayer)).r;
+}
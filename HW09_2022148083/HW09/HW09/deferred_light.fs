@@ -0,0 +1,182 @@
+#version 330 core
+// lighting pass of the deferred path: one fullscreen triangle per light,
+// lightPass 0: ambient + dirLight (and the G-buffer depth), 1: pointLights[lightIndex]
+out vec4 FragColor;
+
+struct Material {
+    float shininess;
+};
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+#define NR_POINT_LIGHTS 1
+#define NR_CASCADES 3
+
+in vec2 ScreenUV;
+
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gDepth;
+uniform vec2 uvScale;           // covered part of the G-buffer (dynamic resolution)
+uniform mat4 invViewProj;
+uniform mat4 view;
+uniform int lightPass;
+uniform int lightIndex;
+
+uniform vec3 viewPos;
+uniform DirLight dirLight;
+uniform PointLight pointLights[NR_POINT_LIGHTS];
+uniform Material material;
+
+// shadow atlas, same layout as 6.multiple_lights.fs
+uniform bool shadowsEnabled;
+uniform sampler2DShadow shadowAtlas;
+uniform vec2 shadowTexelSize;
+uniform mat4 cascadeMatrices[NR_CASCADES];
+uniform vec4 cascadeRects[NR_CASCADES];
+uniform float cascadeSplits[NR_CASCADES];
+uniform mat4 pointShadowMatrices[NR_POINT_LIGHTS * 6];
+uniform vec4 pointShadowRects[NR_POINT_LIGHTS * 6];
+
+vec3 FragPos;
+vec3 Albedo;
+float Specular;
+
+// function prototypes
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, float shadow);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, float shadow);
+float SampleShadow(mat4 atlasMatrix, vec4 rect, vec3 pos);
+float DirShadow(vec3 normal);
+float PointShadow(int light, vec3 normal);
+
+void main()
+{
+    vec2 gUV = ScreenUV * uvScale;
+    float depth = texture(gDepth, gUV).r;
+    if (depth == 1.0) {
+        // background: keep the clear color
+        if (lightPass != 0)
+            discard;
+        gl_FragDepth = 1.0;
+        FragColor = vec4(0.1, 0.1, 0.1, 1.0);
+        return;
+    }
+    gl_FragDepth = depth;
+
+    // world position from the depth buffer
+    vec4 p = invViewProj * vec4(vec3(ScreenUV, depth) * 2.0 - 1.0, 1.0);
+    FragPos = p.xyz / p.w;
+    vec3 norm = normalize(texture(gNormal, gUV).xyz * 2.0 - 1.0);
+    vec4 albedoSpec = texture(gAlbedoSpec, gUV);
+    Albedo = albedoSpec.rgb;
+    Specular = albedoSpec.a;
+
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 result;
+    if (lightPass == 0)
+        result = CalcDirLight(dirLight, norm, viewDir, DirShadow(norm));
+    else
+        result = CalcPointLight(pointLights[lightIndex], norm, FragPos, viewDir, PointShadow(lightIndex, norm));
+
+    FragColor = vec4(result, 1.0);
+}
+
+// calculates the color when using a directional light.
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, float shadow)
+{
+    vec3 lightDir = normalize(-light.direction);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // combine results
+    vec3 ambient = light.ambient * Albedo;
+    vec3 diffuse = light.diffuse * diff * Albedo;
+    vec3 specular = light.specular * spec * Specular;
+    return (ambient + shadow * (diffuse + specular));
+}
+
+// calculates the color when using a point light.
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, float shadow)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // attenuation
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    // combine results
+    vec3 ambient = light.ambient * Albedo;
+    vec3 diffuse = light.diffuse * diff * Albedo;
+    vec3 specular = light.specular * spec * Specular;
+    ambient *= attenuation;
+    diffuse *= attenuation;
+    specular *= attenuation;
+    return (ambient + shadow * (diffuse + specular));
+}
+
+// 3x3 PCF inside one atlas tile; 1.0 = fully lit
+float SampleShadow(mat4 atlasMatrix, vec4 rect, vec3 pos)
+{
+    vec4 p = atlasMatrix * vec4(pos, 1.0);
+    p.xyz /= p.w;
+    if (p.z >= 1.0)
+        return 1.0;
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x++)
+        for(int y = -1; y <= 1; y++)
+        {
+            vec2 uv = clamp(p.xy + vec2(x, y) * shadowTexelSize, rect.xy, rect.zw);
+            lit += texture(shadowAtlas, vec3(uv, p.z));
+        }
+    return lit / 9.0;
+}
+
+float DirShadow(vec3 normal)
+{
+    if (!shadowsEnabled)
+        return 1.0;
+    float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+    vec3 pos = FragPos + normal * 0.02;
+    for(int i = 0; i < NR_CASCADES; i++)
+        if (viewDepth < cascadeSplits[i])
+            return SampleShadow(cascadeMatrices[i], cascadeRects[i], pos);
+    return 1.0;
+}
+
+float PointShadow(int light, vec3 normal)
+{
+    if (!shadowsEnabled)
+        return 1.0;
+    // cube face by major axis: +X, -X, +Y, -Y, +Z, -Z
+    vec3 d = FragPos - pointLights[light].position;
+    vec3 a = abs(d);
+    int face;
+    if (a.x >= a.y && a.x >= a.z) face = d.x > 0.0 ? 0 : 1;
+    else if (a.y >= a.z) face = d.y > 0.0 ? 2 : 3;
+    else face = d.z > 0.0 ? 4 : 5;
+    int i = light * 6 + face;
+    return SampleShadow(pointShadowMatrices[i], pointShadowRects[i], FragPos + normal * 0.02);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+// fullscreen triangle, no vertex buffer
+
+out vec2 ScreenUV;
+
+void main()
+{
+    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    ScreenUV = p;
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+out vec4 FragColor;
+
+#include "lod_dither.glsl"
+
+// color writes are masked during the pre-pass; the overdraw counter adds this up
+void main()
+{
+    if (LodDiscard()) discard;
+    FragColor = vec4(1.0);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+// depth pre-pass: computes gl_Position exactly like 6.multiple_lights.vs so the
+// shading pass can test with GL_EQUAL
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+invariant gl_Position;
+
+void main()
+{
+    vec3 FragPos = vec3(model * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
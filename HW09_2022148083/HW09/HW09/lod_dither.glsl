@@ -0,0 +1,15 @@
+// LOD cross-fade (lod.h): 0 off, t > 0 incoming level, -t outgoing level.
+// Included by every fragment shader that draws a LOD level (ShaderManager expands
+// #include), so the depth pre-pass, forward and G-buffer passes discard the same
+// pixels and GL_EQUAL still matches during a cross-fade.
+uniform float lodFade;
+
+// 4x4 ordered dither: the two levels of a cross-fade cover complementary pixels
+bool LodDiscard()
+{
+    const float bayer[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0,
+                                      3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    ivec2 p = ivec2(gl_FragCoord.xy) & 3;
+    float threshold = (bayer[p.y * 4 + p.x] + 0.5) / 16.0;
+    return lodFade > 0.0 ? threshold >= lodFade : lodFade < 0.0 && threshold < -lodFade;
+}
@@ -2,6 +2,23 @@
 //      Mouse: Arcball manipulation
 //      Keyboard: 'r' - reset arcball
 //                'a' - toggle camera/object rotation
+//                '=' / '-' - more/fewer cylinder segments
+//                'f' - toggle cylinder flat/smooth shading
+//                's' - toggle shadows (prints shadow map re-render statistics)
+//                'd' - toggle forward/deferred shading
+//                'z' - toggle depth pre-pass (forward shading then tests with GL_EQUAL)
+//                'o' - toggle overdraw counting (prints a shading count histogram every second)
+//                'g' - print the GL calls issued / filtered by the state cache in the last frame
+//                      and the state changes of the last sorted render queue
+//                      (with GPU culling on, also checks the culled draws against the CPU)
+//                'm' - toggle multi-draw indirect for the forward pass (needs ARB_multi_draw_indirect)
+//                'l' - toggle cylinder level of detail (cross-faded when the level changes)
+//                '[' / ']' - move the camera closer/farther
+//                'c' - toggle GPU culling of the cylinder and a 32x32 field of cylinders
+//                      (forward shading; compute frustum + hierarchical-Z test, one indirect draw)
+//                'i' - toggle input-to-present latency measurement (reported every second)
+//                'u' - toggle dynamic resolution (render scale follows the GPU frame time)
+//                ',' / '.' - lower/raise the dynamic resolution frame budget by 1 ms
 
 #include <GL/glew.h> 
 #include <GLFW/glfw3.h>
@@ -13,7 +30,21 @@
 
 #include <shader.h>
 #include <cube.h>
+#include <shader_manager.h>
+#include <gl_state.h>
 #include "cylinder.h"
+#include "shadow_maps.h"
+#include "deferred.h"
+#include "overdraw.h"
+#include <material_pool.h>
+#include <render_queue.h>
+#include <geometry_arena.h>
+#include <lod.h>
+#include <gpu_culling.h>
+#include <frame_latency.h>
+#include <mesh_import.h>
+#include <resource_manager.h>
+#include <dynamic_resolution.h>
 #include <arcball.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -27,17 +58,45 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void cursor_position_callback(GLFWwindow* window, double x, double y);
-unsigned int loadTexture(const char*);
+void setLightingUniforms(ShaderProgram* shader);
 void render();
+void renderForward();
+void renderDeferred();
+void useForwardShader(ShaderProgram* shader);
+void drawLitGeometry(ShaderProgram* shader, bool batched = false);
+void depthPrepass();
+void countOverdraw();
+void buildCylinderLods();
+void submitCylinder(ShaderProgram* shader, Cylinder* mesh, float lodFade);
+void submitImportedMesh(ShaderProgram* shader);
+void cullInstances();
+void drawCulledGeometry(ShaderProgram* shader);
+void buildCullInstances();
 
 // Global variables
 GLFWwindow* mainWindow = NULL;
-Shader* lightingShader = NULL;
+ShaderManager* shaders = NULL;
+ShaderProgram* lightingShader = NULL;
 Shader* lampShader = NULL;
+ShaderProgram* shadowShader = NULL;
+ShaderProgram* gBufferShader = NULL;
+ShaderProgram* deferredLightShader = NULL;
+ShaderProgram* prepassShader = NULL;
+ShaderProgram* multiDrawShader = NULL;
+ShaderProgram* culledShader = NULL;
+ShaderProgram* cullProgram = NULL;
+ShaderProgram* hizProgram = NULL;
 unsigned int SCR_WIDTH = 600;
 unsigned int SCR_HEIGHT = 600;
 Cube* cube;
 Cylinder* cylinder;
+
+// the cube and the cylinders live in pools; a replaced LOD level is destroyed once
+// the frames still drawing it have finished on the GPU
+ResourceManager* resources = NULL;
+Pool<Cube>* cubePool = NULL;
+Pool<Cylinder>* cylinderPool = NULL;
+std::vector<Handle<Cylinder>> cylinderLodHandles;      // parallel to cylinderLods
 Cube* lamp;
 glm::mat4 projection, view, model;
 
@@ -61,52 +120,229 @@ glm::vec3 pointLightPositions[] = {
 };
 
 // for texture
-static unsigned int diffuseMap, specularMap;  // texture ids for diffuse and specular maps
+// every material map is a layer of one array texture, bound once to unit 0
+MaterialTexturePool* materialPool = NULL;
+Material containerMaterial;
+
+// for shadows: maps are re-rendered only when a light or a caster inside them moves
+glm::vec3 dirLightDirection(-0.2f, -1.0f, -0.3f);
+ShadowMaps* shadowMaps = NULL;
+ShadowCaster cylinderCaster;
+ShadowCaster importedCaster;            // in shadowCasters only when the mesh loaded
+std::vector<ShadowCaster*> shadowCasters;
+bool shadowsEnabled = true;
+
+// for deferred shading
+DeferredRenderer* deferred = NULL;
+bool deferredShading = false;
+float pointLightRadius;         // light volume of pointLights[0]
+
+// for depth pre-pass and overdraw counting
+bool depthPrepassEnabled = false;
+bool overdrawCounting = false;
+OverdrawCounter* overdraw = NULL;
+double lastOverdrawReport = 0.0;
+
+// for dynamic resolution: the scene is drawn smaller when the GPU misses the frame budget
+DynamicResolution* resolution = NULL;
+ShaderProgram* upscaleShader = NULL;
+
+// every pass submits its draws here; they run sorted by shader, material, VAO and depth
+RenderQueue renderQueue;
+
+// every mesh of the cylinder format lives in one arena: one VAO, one VBO, one EBO;
+// with multi-draw the forward pass is a single glMultiDrawElementsIndirect
+GeometryArena<Cylinder::Format>* arena = NULL;
+IndirectBatch* multiDrawBatch = NULL;
+bool multiDraw = false;
+
+// level of detail: cylinderLods[0] is the cylinder itself, each next level has half the segments
+std::vector<Cylinder*> cylinderLods;
+LodChain cylinderLodChain;
+LodState cylinderLod;
+bool lodEnabled = true;
+unsigned int lodSwitches = 0;       // level changes since start, reported by 'g'
+double lastFrameTime = 0.0;
+
+// GPU culling: instance 0 is the cylinder, the others a field behind it;
+// a compute pass culls them and writes the draws, the CPU cost does not grow with the field
+GpuCuller* culler = NULL;
+bool gpuCulling = false;
+const int CULL_FIELD_SIZE = 32;
+const glm::vec4 cylinderSphere(0.0f, 0.0f, 0.0f, 1.7321f);     // decoded positions lie in the unit cube
+
+// one frame in flight, input latched right before the matrices are built
+FrameLatency frameLatency;
+
+// a mesh exported from the HW10 Blender scene, when present: imported once, mapped from its cache afterwards
+MeshAsset* importedMesh = NULL;
+glm::mat4 importedModel;
 
 
 int main()
 {
     mainWindow = glAllInit();
 
-    // shader loading and compile (by calling the constructor)
-    lightingShader = new Shader("6.multiple_lights.vs", "6.multiple_lights.fs");
-    lampShader = new Shader("6.lamp.vs", "6.lamp.fs");
-
     // projection and view matrix
-    lightingShader->use();
     projection = glm::perspective(glm::radians(45.0f),
         (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    lightingShader->setMat4("projection", projection);
 
+    // shader loading: every program is submitted at once and compiles in parallel;
+    // the uniforms are set when a program becomes ready (ShaderManager::poll() in render())
+    shaders = new ShaderManager(mainWindow);
+    lightingShader = shaders->submit("6.multiple_lights.vs", "6.multiple_lights.fs", [](ShaderProgram* shader) {
+        shader->use();
+        shader->setMat4("projection", projection);
+        setLightingUniforms(shader);
+        // the cylinder uploads only the attributes the lighting shader reads
+        Cylinder::Format::verify(shader->ID, "6.multiple_lights");
+    });
+    shadowShader = shaders->submit("shadow_depth.vs", "shadow_depth.fs");
+    gBufferShader = shaders->submit("6.multiple_lights.vs", "deferred_geometry.fs", [](ShaderProgram* shader) {
+        shader->use();
+        shader->setMat4("projection", projection);
+        setLightingUniforms(shader);
+    });
+    deferredLightShader = shaders->submit("deferred_light.vs", "deferred_light.fs", setLightingUniforms);
+    upscaleShader = shaders->submit("deferred_light.vs", "upscale.fs");
+    prepassShader = shaders->submit("depth_prepass.vs", "depth_prepass.fs", [](ShaderProgram* shader) {
+        shader->use();
+        shader->setMat4("projection", projection);
+    });
+    // model matrices from an SSBO indexed by gl_DrawIDARB; GLSL 4.30 only where it can run
+    if (IndirectBatch::supported()) {
+        multiDrawShader = shaders->submit("6.multiple_lights_mdi.vs", "6.multiple_lights.fs", [](ShaderProgram* shader) {
+            shader->use();
+            shader->setMat4("projection", projection);
+            setLightingUniforms(shader);
+        });
+    }
+    // culling and the hierarchical-Z pyramid are compute passes (GL 4.3)
+    if (GpuCuller::supported()) {
+        culledShader = shaders->submit("6.multiple_lights_culled.vs", "6.multiple_lights.fs", [](ShaderProgram* shader) {
+            shader->use();
+            shader->setMat4("projection", projection);
+            setLightingUniforms(shader);
+        });
+        cullProgram = shaders->submitCompute("cull_instances.comp");
+        hizProgram = shaders->submitCompute("hiz_build.comp");
+    }
+
+    // Cube::draw() takes a Shader, so the lamp shader is still built by its (blocking)
+    // constructor; the submitted programs keep compiling meanwhile
+    lampShader = new Shader("6.lamp.vs", "6.lamp.fs");
     lampShader->use();
     lampShader->setMat4("projection", projection);
 
     // load texture
-    diffuseMap = loadTexture("container2.bmp");
-    specularMap = loadTexture("container2_specular.bmp");
+    materialPool = new MaterialTexturePool(512);
+    containerMaterial.diffuseLayer = materialPool->add("container2.bmp");
+    containerMaterial.specularLayer = materialPool->add("container2_specular.bmp");
+    containerMaterial.shininess = 32.0f;
+    materialPool->build();
+    materialPool->bind(0);
+
+    // create a cubes
+    resources = new ResourceManager();
+    cubePool = new Pool<Cube>(1);
+    cylinderPool = new Pool<Cylinder>(64);     // a level chain of 48 * 2^k segments, plus replaced levels in flight
+    cube = cubePool->get(cubePool->create());
+    arena = new GeometryArena<Cylinder::Format>(GL_UNSIGNED_SHORT);     // no level exceeds 0xFFFF vertices
+    multiDrawBatch = new IndirectBatch();
+    Handle<Cylinder> cylinderHandle = cylinderPool->create(48, arena);
+    cylinder = cylinderPool->get(cylinderHandle);
+    cylinderLodHandles.assign(1, cylinderHandle);
+    buildCylinderLods();
+    if (GpuCuller::supported()) {
+        culler = new GpuCuller(cullProgram, hizProgram);
+        culler->attachDrawIndex(arena->VAO);
+    }
+
+    // shadow atlas: 3 cascades for dirLight, 6 cube faces for pointLights[0]
+    shadowMaps = new ShadowMaps(shadowShader);
+    cylinderCaster.draw = [](ShaderProgram* shader) { cylinderLods[cylinderLod.level]->draw(shader); };
+    shadowCasters.push_back(&cylinderCaster);
+
+    // deferred path: G-buffer + per-light fullscreen passes scissored to the light volume
+    deferred = new DeferredRenderer(gBufferShader, deferredLightShader);
+    pointLightRadius = point_light_radius(1.0f, 0.09f, 0.032f, 1.0f);
+
+    overdraw = new OverdrawCounter();
+    resolution = new DynamicResolution(upscaleShader);
+
+    // scaled into a 2 unit cube beside the cylinder; the repo does not ship the export,
+    // so without it the scene is drawn as before
+    if (MeshAsset::available("hw10.obj")) importedMesh = new MeshAsset();
+    if (importedMesh != NULL && importedMesh->load("hw10.obj")) {
+        float scale = importedMesh->radius() > 0.0f ? 1.0f / importedMesh->radius() : 1.0f;
+        importedModel = glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, 0.0f, 0.0f));
+        importedModel = glm::scale(importedModel, glm::vec3(scale));
+        importedModel = glm::translate(importedModel, -importedMesh->center());
+
+        // the transform never changes: one update marks the maps it falls in dirty once
+        importedCaster.draw = [](ShaderProgram* shader) {
+            gl_state().bindVertexArray(importedMesh->VAO);
+            glDrawElements(GL_TRIANGLES, (GLsizei)importedMesh->indexCount, importedMesh->indexType, 0);
+        };
+        importedCaster.update(importedModel, importedMesh->center(), importedMesh->radius());
+        shadowCasters.push_back(&importedCaster);
+    }
+    else {
+        delete importedMesh;
+        importedMesh = NULL;
+    }
+
+    while (!glfwWindowShouldClose(mainWindow)) {
+        frameLatency.wait();
+        render();
+    }
+
+    frameLatency.release();
+    // queued destructions run first; their pools go after, both before the context
+    delete resources;
+    delete cylinderPool;
+    delete cubePool;
+    delete importedMesh;
+    delete culler;
+    delete overdraw;
+    delete resolution;
+    delete deferred;
+    delete shadowMaps;
+    delete multiDrawBatch;
+    delete arena;
+    delete materialPool;
+    // the programs last: the manager's worker thread and shared context go with it
+    delete lampShader;
+    delete shaders;
+    gl_names().release();                   // batched names never handed out
+    memory_tracker().reportLeaks();
+    glfwTerminate();
+    return 0;
+}
 
-    // transfer texture id to fragment shader
-    lightingShader->use();
-    lightingShader->setInt("material.diffuse", 0);
-    lightingShader->setInt("material.specular", 1);
-    lightingShader->setFloat("material.shininess", 32);
+// material and light uniforms shared by the forward and the deferred shaders
+void setLightingUniforms(ShaderProgram* shader) {
+    shader->use();
+    // transfer texture id to fragment shader (the layers are set per draw)
+    shader->setInt("material.maps", 0);
+    shader->setFloat("material.shininess", 32);
 
-    lightingShader->setVec3("viewPos", cameraPos);
+    shader->setVec3("viewPos", cameraPos);
 
     // transfer lighting parameters to fragment shader
     // directional light
-    lightingShader->setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-    lightingShader->setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-    lightingShader->setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-    lightingShader->setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
+    shader->setVec3("dirLight.direction", dirLightDirection);
+    shader->setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
+    shader->setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
+    shader->setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
     // point light 1
-    lightingShader->setVec3("pointLights[0].position", pointLightPositions[0]);
-    lightingShader->setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-    lightingShader->setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-    lightingShader->setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-    lightingShader->setFloat("pointLights[0].constant", 1.0f);
-    lightingShader->setFloat("pointLights[0].linear", 0.09);
-    lightingShader->setFloat("pointLights[0].quadratic", 0.032);
+    shader->setVec3("pointLights[0].position", pointLightPositions[0]);
+    shader->setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
+    shader->setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
+    shader->setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
+    shader->setFloat("pointLights[0].constant", 1.0f);
+    shader->setFloat("pointLights[0].linear", 0.09);
+    shader->setFloat("pointLights[0].quadratic", 0.032);
 
     glm::vec3 lightCenter = glm::vec3(0.0f, 3.0f, 0.0f);
 
@@ -116,22 +352,9 @@ int main()
     // circular light source ϴ  
     glm::vec3 lightDirection = glm::normalize(glm::vec3(-1.0f, -1.0f, -1.0f));
 
-    lightingShader->setVec3("pointLight.center", lightCenter); // circular light source ߽ ǥ
-    lightingShader->setFloat("pointLight.radius", lightRadius); // circular light source 
-    lightingShader->setVec3("pointLight.direction", lightDirection); // circular light source ϴ  
-
-
-    // create a cubes
-    cube = new Cube();
-    cylinder = new Cylinder(48);
-
-    while (!glfwWindowShouldClose(mainWindow)) {
-        render();
-        glfwPollEvents();
-    }
-
-    glfwTerminate();
-    return 0;
+    shader->setVec3("pointLight.center", lightCenter); // circular light source ߽ ǥ
+    shader->setFloat("pointLight.radius", lightRadius); // circular light source 
+    shader->setVec3("pointLight.direction", lightDirection); // circular light source ϴ  
 }
 
 GLFWwindow* glAllInit()
@@ -164,7 +387,7 @@ GLFWwindow* glAllInit()
 
     // OpenGL states
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-    glEnable(GL_DEPTH_TEST);
+    gl_state().enable(GL_DEPTH_TEST);
 
     // Allow modern extension features
     glewExperimental = GL_TRUE;
@@ -178,67 +401,50 @@ GLFWwindow* glAllInit()
     return window;
 }
 
-unsigned int loadTexture(const char* texFileName) {
-    unsigned int texture;
-
-    // Create texture ids.
-    glGenTextures(1, &texture);
-
-    // All upcomming GL_TEXTURE_2D operations now on "texture" object
-    glBindTexture(GL_TEXTURE_2D, texture);
-
-    // Set texture parameters for wrapping.
-    //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    // Set texture parameters for filtering.
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true);   // vertical flip the texture
-    unsigned char* image = stbi_load(texFileName, &width, &height, &nrChannels, 0);
-    if (!image) {
-        printf("texture %s loading error ... \n", texFileName);
-    }
-    else printf("texture %s loaded\n", texFileName);
+void render() {
 
-    GLenum format;
-    if (nrChannels == 1) format = GL_RED;
-    else if (nrChannels == 3) format = GL_RGB;
-    else if (nrChannels == 4) format = GL_RGBA;
+    // programs that finished compiling since the last frame become usable
+    shaders->poll();
 
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    // input as late as possible: everything below sees this frame's arcball state
+    frameLatency.latch();
 
-    return texture;
-}
-
-void render() {
-
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // the GPU timer covers everything from here to the upscale
+    resolution->beginFrame(SCR_WIDTH, SCR_HEIGHT);
 
     view = glm::lookAt(cameraPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     view = view * camArcBall.createRotationMatrix();
 
-    // cube objects
-    lightingShader->use();
-    lightingShader->setMat4("view", view);
-
-    // texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, diffuseMap);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, specularMap);
-
-    // cube1
     model = glm::mat4(1.0f);
     model = model * modelArcBall.createRotationMatrix();
-    lightingShader->setMat4("model", model);
-    cylinder->draw(lightingShader);
 
+    // cylinder level from the projected chord error of each level
+    double now = glfwGetTime();
+    float dt = lastFrameTime > 0.0 ? (float)(now - lastFrameTime) : 0.0f;
+    lastFrameTime = now;
+    int previousLevel = cylinderLod.level;
+    if (lodEnabled) {
+        cylinderLodChain.screenHeight = resolution->renderHeight;
+        cylinderLodChain.select(cylinderLod, -(view * model * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)).z, dt);
+    }
+    if (cylinderLod.level != previousLevel) {
+        cylinderCaster.touch();
+        lodSwitches++;
+    }
+    Cylinder* lodMesh = cylinderLods[cylinderLod.level];
+
+    // shadow maps: only the dirty ones are rendered, nothing on idle frames
+    // (the cylinder's decoded positions lie in the unit cube: radius sqrt(3))
+    cylinderCaster.update(model * lodMesh->decodeMatrix(), glm::vec3(0.0f), 1.7321f);
+    shadowMaps->updateDirectional(dirLightDirection, view, glm::radians(45.0f),
+        (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 20.0f);
+    shadowMaps->updatePoint(0, pointLightPositions[0], 25.0f);
+    if (shadowsEnabled && shadowShader->ready())
+        shadowMaps->render(shadowCasters, SCR_WIDTH, SCR_HEIGHT);
+
+    resolution->bindTarget();
+    if (deferredShading && gBufferShader->ready() && deferredLightShader->ready()) renderDeferred();
+    else renderForward();
 
     // lamps (point lights)
     lampShader->use();
@@ -250,8 +456,219 @@ void render() {
         lampShader->setMat4("model", model);
         cube->draw(lampShader);
     }
+    // Shader::use() and Cube::draw() call GL directly
+    gl_state().invalidate();
+
+    resolution->resolve();
+
+    if (overdrawCounting && prepassShader->ready())
+        countOverdraw();
 
     glfwSwapBuffers(mainWindow);
+    frameLatency.presented();
+    resources->endFrame();
+    gl_state().endFrame();
+}
+
+// every light is evaluated for every rasterized fragment
+void renderForward() {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (!lightingShader->ready()) return;
+
+    // GPU culling: the compute pass writes this frame's draw commands first
+    bool culled = gpuCulling && culledShader->ready() && cullProgram->ready() && hizProgram->ready();
+    if (culled)
+        cullInstances();
+
+    // lay down the final depth first so only the visible fragment of each pixel is shaded
+    bool prepass = !culled && depthPrepassEnabled && prepassShader->ready();
+    if (prepass)
+        depthPrepass();
+
+    // cube objects; the batch has no per-draw lodFade, so during a LOD cross-fade the
+    // per-draw path draws both levels with the same dither as the pre-pass
+    bool batched = multiDraw && multiDrawShader != NULL && multiDrawShader->ready() && cylinderLod.previous < 0;
+    ShaderProgram* shader = culled ? culledShader : batched ? multiDrawShader : lightingShader;
+    useForwardShader(shader);
+
+    // cube1
+    if (culled) drawCulledGeometry(shader);
+    else drawLitGeometry(shader, batched);
+
+    if (prepass) {
+        gl_state().depthFunc(GL_LESS);
+        gl_state().depthMask(GL_TRUE);
+    }
+}
+
+// per-frame uniforms of a forward shading program
+void useForwardShader(ShaderProgram* shader) {
+    shader->use();
+    shader->setMat4("view", view);
+
+    shadowMaps->apply(shader, 2);
+    shader->setBool("shadowsEnabled", shadowsEnabled);
+}
+
+// the objects shaded by the lighting shaders, in render queue order;
+// a material change is only a layer index change.
+// batched: shader reads its model matrices by gl_DrawIDARB, the arena meshes go in one call
+void drawLitGeometry(ShaderProgram* shader, bool batched) {
+    Cylinder* mesh = cylinderLods[cylinderLod.level];
+    if (batched) {
+        set_material(shader, containerMaterial);
+        shader->setFloat("lodFade", 0.0f);      // batched only while no cross-fade runs
+        multiDrawBatch->clear();
+        multiDrawBatch->add(mesh->range, model * mesh->decodeMatrix());
+        multiDrawBatch->submit(arena->VAO, arena->indexType, shader, true);
+
+        // the imported mesh is not in the arena: it is drawn with the per-draw program
+        if (importedMesh != NULL) {
+            useForwardShader(lightingShader);
+            renderQueue.begin(view, 100.0f, resources->frame());
+            submitImportedMesh(lightingShader);
+            renderQueue.execute();
+        }
+        return;
+    }
+
+    // during a cross-fade both levels draw, each into its half of the dither pattern
+    float incoming, outgoing;
+    lod_fade_uniforms(cylinderLod, incoming, outgoing);
+    renderQueue.begin(view, 100.0f, resources->frame());
+    submitCylinder(shader, mesh, incoming);
+    if (cylinderLod.previous >= 0)
+        submitCylinder(shader, cylinderLods[cylinderLod.previous], outgoing);
+    if (importedMesh != NULL)
+        submitImportedMesh(shader);
+    renderQueue.execute();
+}
+
+void submitCylinder(ShaderProgram* shader, Cylinder* mesh, float lodFade) {
+    renderQueue.submit(PASS_OPAQUE, { shader, &containerMaterial, mesh->VAO, GL_TRIANGLES,
+        (GLsizei)mesh->indexCount, mesh->indexType, model * mesh->decodeMatrix(),
+        mesh->indexOffset, mesh->baseVertex, lodFade });
+}
+
+void submitImportedMesh(ShaderProgram* shader) {
+    renderQueue.submit(PASS_OPAQUE, { shader, &containerMaterial, importedMesh->VAO, GL_TRIANGLES,
+        (GLsizei)importedMesh->indexCount, importedMesh->indexType, importedModel, 0, 0, 0.0f });
+}
+
+// instance 0 follows the model arcball and the LOD level; the field never changes
+void cullInstances() {
+    Cylinder* mesh = cylinderLods[cylinderLod.level];
+    culler->setInstance(0, cull_instance(mesh->range, model * mesh->decodeMatrix(), cylinderSphere));
+    culler->cull(projection * view);
+}
+
+// whatever survived culling in one indirect draw, then the pyramid the next frame tests against;
+// the imported mesh is not in the arena and is drawn (and occludes) with the per-draw program
+void drawCulledGeometry(ShaderProgram* shader) {
+    set_material(shader, containerMaterial);
+    culler->draw(arena->VAO, arena->indexType);
+    if (importedMesh != NULL) {
+        useForwardShader(lightingShader);
+        renderQueue.begin(view, 100.0f, resources->frame());
+        submitImportedMesh(lightingShader);
+        renderQueue.execute();
+    }
+    culler->buildHiZ(projection * view, resolution->renderWidth, resolution->renderHeight);
+}
+
+// the cylinder and a field of smaller, coarser cylinders on the floor behind it
+void buildCullInstances() {
+    std::vector<CullInstance> instances;
+    Cylinder* mesh = cylinderLods[cylinderLod.level];
+    instances.push_back(cull_instance(mesh->range, model * mesh->decodeMatrix(), cylinderSphere));
+
+    Cylinder* fieldMesh = cylinderLods[cylinderLods.size() > 2 ? 2 : cylinderLods.size() - 1];
+    for (int z = 0; z < CULL_FIELD_SIZE; z++) {
+        for (int x = 0; x < CULL_FIELD_SIZE; x++) {
+            glm::mat4 fieldModel = glm::translate(glm::mat4(1.0f),
+                glm::vec3((x - (CULL_FIELD_SIZE - 1) * 0.5f) * 1.5f, -2.0f, -3.0f - z * 1.5f));
+            fieldModel = glm::scale(fieldModel, glm::vec3(0.5f));
+            instances.push_back(cull_instance(fieldMesh->range, fieldModel * fieldMesh->decodeMatrix(), cylinderSphere));
+        }
+    }
+    culler->setInstances(instances);
+    culler->invalidateHiZ();
+}
+
+// rebuild the coarser levels after the finest one (cylinder) changed
+void buildCylinderLods() {
+    for (size_t i = 1; i < cylinderLodHandles.size(); i++) resources->destroy(*cylinderPool, cylinderLodHandles[i]);
+    cylinderLods.assign(1, cylinder);
+    cylinderLodHandles.resize(1);
+    cylinderLodChain.errors.clear();
+    cylinderLodChain.triangles.clear();
+
+    std::vector<int> segments = lod_segment_chain(cylinder->n, cylinder->n < 6 ? cylinder->n : 6);
+    for (size_t i = 0; i < segments.size(); i++) {
+        if (i > 0) {
+            Handle<Cylinder> handle = cylinderPool->create(segments[i], arena);
+            Cylinder* level = cylinderPool->get(handle);
+            if (level == NULL) break;
+            if (cylinder->flat_shading) {
+                level->flat_shading = true;
+                level->render();
+            }
+            cylinderLods.push_back(level);
+            cylinderLodHandles.push_back(handle);
+        }
+        cylinderLodChain.addLevel(cylinder_lod_error(1.0f, segments[i]), segments[i] * 2);
+    }
+    cylinderLod = LodState();
+    // the arena ranges moved
+    if (gpuCulling) buildCullInstances();
+}
+
+// depth only; leaves GL_EQUAL without depth writes for the shading pass
+void depthPrepass() {
+    prepassShader->use();
+    prepassShader->setMat4("view", view);
+    gl_state().colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    drawLitGeometry(prepassShader);
+    gl_state().colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    gl_state().depthFunc(GL_EQUAL);
+    gl_state().depthMask(GL_FALSE);
+}
+
+// replay the forward shading pass into the overdraw counter with the current pre-pass setting
+void countOverdraw() {
+    overdraw->begin(SCR_WIDTH, SCR_HEIGHT);
+    if (depthPrepassEnabled)
+        depthPrepass();
+
+    prepassShader->use();
+    prepassShader->setMat4("view", view);
+    overdraw->beginShading();
+    drawLitGeometry(prepassShader);
+    overdraw->end();
+
+    gl_state().depthFunc(GL_LESS);
+    gl_state().depthMask(GL_TRUE);
+
+    double now = glfwGetTime();
+    if (now - lastOverdrawReport >= 1.0) {
+        overdraw->report(depthPrepassEnabled ? "pre-pass + GL_EQUAL" : "no pre-pass");
+        lastOverdrawReport = now;
+    }
+}
+
+// the scene fills the G-buffer, then each light shades only the visible pixels it reaches
+void renderDeferred() {
+    deferred->beginGeometry(SCR_WIDTH, SCR_HEIGHT, resolution->renderWidth, resolution->renderHeight);
+    gBufferShader->setMat4("view", view);
+    drawLitGeometry(gBufferShader);
+
+    deferred->beginLighting(projection, view, resolution->framebuffer());
+    shadowMaps->apply(deferredLightShader, 2);
+    deferredLightShader->setBool("shadowsEnabled", shadowsEnabled);
+    deferred->directionalPass();
+    for (int i = 0; i < 1; i++)
+        deferred->pointLightPass(i, pointLightPositions[i], pointLightRadius, projection * view);
+    deferred->endLighting();
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -260,12 +677,13 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    gl_state().viewport(0, 0, width, height);
     SCR_WIDTH = width;
     SCR_HEIGHT = height;
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    frameLatency.input();
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
@@ -282,9 +700,113 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
             cout << "ARCBALL: Model  rotation mode" << endl;
         }
     }
+    else if ((key == GLFW_KEY_EQUAL || key == GLFW_KEY_MINUS) && action == GLFW_PRESS) {
+        // the cylinder keeps its VAO/VBO/EBO and updates them in place
+        int n = cylinder->n;
+        if (key == GLFW_KEY_EQUAL) n = n * 2 < CYLINDER_MAX_SEGMENTS ? n * 2 : CYLINDER_MAX_SEGMENTS;
+        else if (n > 3) n /= 2;
+        if (n == cylinder->n) return;
+        cylinder->n = n;
+        cylinder->render();
+        buildCylinderLods();
+        cylinderCaster.touch();
+        cout << "CYLINDER: " << cylinder->n << " segments" << endl;
+    }
+    else if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+        cylinder->flat_shading = !cylinder->flat_shading;
+        cylinder->render();
+        buildCylinderLods();
+        cylinderCaster.touch();
+        cout << "CYLINDER: " << (cylinder->flat_shading ? "flat" : "smooth") << " shading" << endl;
+    }
+    else if (key == GLFW_KEY_D && action == GLFW_PRESS) {
+        deferredShading = !deferredShading;
+        cout << "RENDER: " << (deferredShading ? "deferred" : "forward") << " shading" << endl;
+    }
+    else if (key == GLFW_KEY_Z && action == GLFW_PRESS) {
+        depthPrepassEnabled = !depthPrepassEnabled;
+        cout << "RENDER: depth pre-pass " << (depthPrepassEnabled ? "on" : "off") << endl;
+    }
+    else if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+        overdrawCounting = !overdrawCounting;
+        cout << "OVERDRAW: counting " << (overdrawCounting ? "on" : "off") << endl;
+    }
+    else if (key == GLFW_KEY_S && action == GLFW_PRESS) {
+        shadowsEnabled = !shadowsEnabled;
+        cout << "SHADOW: " << (shadowsEnabled ? "on" : "off") << " (" << shadowMaps->mapsRendered
+             << " maps rendered, " << shadowMaps->mapsSkipped << " skipped as clean)" << endl;
+    }
+    else if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+        lodEnabled = !lodEnabled;
+        cylinderLod = LodState();
+        cylinderCaster.touch();
+        cout << "LOD: " << (lodEnabled ? "on" : "off") << " (" << cylinderLods.size() << " levels)" << endl;
+    }
+    else if ((key == GLFW_KEY_LEFT_BRACKET || key == GLFW_KEY_RIGHT_BRACKET) && action != GLFW_RELEASE) {
+        cameraPos.z += key == GLFW_KEY_RIGHT_BRACKET ? 2.0f : -2.0f;
+        if (cameraPos.z < 3.0f) cameraPos.z = 3.0f;
+        // viewPos is part of the lighting uniforms
+        ShaderProgram* lit[] = { lightingShader, gBufferShader, deferredLightShader, multiDrawShader, culledShader };
+        for (int i = 0; i < 5; i++)
+            if (lit[i] != NULL && lit[i]->ready()) setLightingUniforms(lit[i]);
+        cout << "CAMERA: distance " << cameraPos.z << endl;
+    }
+    else if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+        multiDraw = !multiDraw && multiDrawShader != NULL;
+        cout << "RENDER: multi-draw indirect " << (multiDraw ? "on" : "off")
+             << (multiDrawShader == NULL ? " (not supported)" : "") << " (" << arena->meshes << " meshes, "
+             << arena->vertices.size() << " vertices in the arena)" << endl;
+    }
+    else if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        cout << "GL STATE: " << gl_state().lastIssued << " calls issued, " << gl_state().lastFiltered
+             << " filtered as redundant in the last frame" << endl;
+        cout << "RENDER: last queue " << renderQueue.draws << " draws, " << renderQueue.shaderChanges
+             << " shader / " << renderQueue.materialChanges << " material / " << renderQueue.vaoChanges
+             << " VAO changes" << endl;
+        if (gpuCulling) {
+            cout << "CULLING: " << culler->visibleCount() << " of " << culler->instanceCount
+                 << " instances visible in the last frame" << endl;
+            // the field is a known set: the compute pass must draw exactly what the CPU test keeps
+            culler->verify(projection * view);
+        }
+        cout << "RESOURCES: " << cylinderPool->live() << " cylinders alive, " << resources->pending()
+             << " destructions waiting for the GPU, " << resources->objectsDestroyed << " destroyed, frame arena peak "
+             << resources->frame().peak << " of " << resources->frame().capacity << " bytes, "
+             << gl_names().namesHandedOut << " GL names from " << gl_names().genCalls << " glGen* calls" << endl;
+        cout << "CYLINDER: " << cylinder->n * 4 << " -> " << cylinder->vertexCount << " vertices, ACMR "
+             << cylinder->acmrBefore << " -> " << cylinder->acmrAfter << endl;
+        cout << "LOD: cylinder level " << cylinderLod.level << " (" << cylinderLods[cylinderLod.level]->n
+             << " segments, " << cylinderLodChain.triangles[cylinderLod.level] << " triangles), "
+             << lodSwitches << " level switches" << endl;
+        memory_tracker().report();
+        cout << "RESOLUTION: " << (int)(resolution->scale * 100.0f + 0.5f) << "%, "
+             << resolution->renderWidth << "x" << resolution->renderHeight << ", GPU "
+             << resolution->gpuMs << " ms of a " << resolution->budgetMs << " ms budget" << endl;
+    }
+    else if (key == GLFW_KEY_I && action == GLFW_PRESS) {
+        frameLatency.setMeasuring(!frameLatency.measuring);
+        cout << "LATENCY: measurement " << (frameLatency.measuring ? "on" : "off") << endl;
+    }
+    else if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+        gpuCulling = !gpuCulling && culler != NULL;
+        if (gpuCulling) buildCullInstances();
+        cout << "CULLING: GPU culling " << (gpuCulling ? "on" : "off")
+             << (culler == NULL ? " (not supported)" : "")
+             << (gpuCulling && GLEW_ARB_indirect_parameters ? ", draw count from the GPU" : "") << endl;
+    }
+    else if (key == GLFW_KEY_U && action == GLFW_PRESS) {
+        resolution->enabled = !resolution->enabled;
+        cout << "RESOLUTION: dynamic resolution " << (resolution->enabled ? "on" : "off (full window)") << endl;
+    }
+    else if ((key == GLFW_KEY_COMMA || key == GLFW_KEY_PERIOD) && action == GLFW_PRESS) {
+        resolution->budgetMs += key == GLFW_KEY_PERIOD ? 1.0f : -1.0f;
+        if (resolution->budgetMs < 1.0f) resolution->budgetMs = 1.0f;
+        cout << "RESOLUTION: frame budget " << resolution->budgetMs << " ms" << endl;
+    }
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+    frameLatency.input();
     if (arcballCamRot)
         camArcBall.mouseButtonCallback(window, button, action, mods);
     else
@@ -292,6 +814,7 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 }
 
 void cursor_position_callback(GLFWwindow* window, double x, double y) {
+    frameLatency.input();
     if (arcballCamRot)
         camArcBall.cursorCallback(window, x, y);
     else
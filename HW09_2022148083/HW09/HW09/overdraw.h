@@ -0,0 +1,125 @@
+#ifndef OVERDRAW_H
+#define OVERDRAW_H
+
+// Overdraw instrumentation.
+// The lit geometry is drawn again into an R32F target with additive blending and a
+// shader that outputs 1.0, under the same depth setup as the real shading pass
+// (GL_LESS, or GL_EQUAL after a depth pre-pass). Every texel then holds how many
+// fragments were shaded for that pixel; end() reads it back into a histogram.
+
+#include <GL/glew.h>
+#include <gl_state.h>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+#define OVERDRAW_BINS 8
+
+class OverdrawCounter {
+public:
+    unsigned int FBO = 0;
+    unsigned int countTex = 0, depthRBO = 0;
+    int width = 0, height = 0;
+
+    // results of the last counted frame
+    unsigned int histogram[OVERDRAW_BINS + 1];  // [k]: pixels shaded k times, last bin: OVERDRAW_BINS or more
+    unsigned int coveredPixels = 0;
+    unsigned int maxCount = 0;
+    unsigned long long shadedFragments = 0;
+
+    OverdrawCounter() {
+        glGenFramebuffers(1, &FBO);
+        for (int i = 0; i <= OVERDRAW_BINS; i++) histogram[i] = 0;
+    }
+
+    ~OverdrawCounter() {
+        release();
+        gl_state().deleteFramebuffers(1, &FBO);
+    }
+
+    // bind and clear the counting target; the caller runs its depth pre-pass (if any) next
+    void begin(int width, int height) {
+        resize(width, height);
+        gl_state().bindFramebuffer(FBO);
+        const GLfloat zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glClearBufferfv(GL_COLOR, 0, zero);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    // from here on every fragment that passes the depth test adds 1
+    void beginShading() {
+        gl_state().enable(GL_BLEND);
+        gl_state().blendFunc(GL_ONE, GL_ONE);
+    }
+
+    void end() {
+        gl_state().disable(GL_BLEND);
+        counts.resize((size_t)width * height);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glReadPixels(0, 0, width, height, GL_RED, GL_FLOAT, counts.data());
+        gl_state().bindFramebuffer(0);
+
+        for (int i = 0; i <= OVERDRAW_BINS; i++) histogram[i] = 0;
+        coveredPixels = maxCount = 0;
+        shadedFragments = 0;
+        for (size_t p = 0; p < counts.size(); p++) {
+            unsigned int n = (unsigned int)(counts[p] + 0.5f);
+            histogram[n < OVERDRAW_BINS ? n : OVERDRAW_BINS]++;
+            if (n > 0) coveredPixels++;
+            if (n > maxCount) maxCount = n;
+            shadedFragments += n;
+        }
+    }
+
+    void report(const char* mode) {
+        std::cout << "OVERDRAW: " << mode << ", " << coveredPixels << " pixels covered, "
+                  << shadedFragments << " fragments shaded (" << std::fixed << std::setprecision(2)
+                  << (coveredPixels ? shadedFragments / (double)coveredPixels : 0.0) << " per pixel, max "
+                  << maxCount << ")" << std::endl;
+        std::cout << "          ";
+        for (int i = 1; i <= OVERDRAW_BINS; i++) {
+            double percent = coveredPixels ? 100.0 * histogram[i] / coveredPixels : 0.0;
+            std::cout << i << (i == OVERDRAW_BINS ? "+: " : ": ") << percent << "%  ";
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+
+private:
+    std::vector<float> counts;
+
+    void resize(int width, int height) {
+        if (width == this->width && height == this->height) return;
+        release();
+        this->width = width;
+        this->height = height;
+
+        glGenTextures(1, &countTex);
+        gl_state().bindTexture(GL_TEXTURE_2D, countTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, NULL);
+        MEMORY_TRACK_TEXTURE(countTex, texture_bytes(GL_R32F, width, height), MEMORY_RENDER_TARGET, "overdraw count");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenRenderbuffers(1, &depthRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        MEMORY_TRACK_RENDERBUFFER(depthRBO, texture_bytes(GL_DEPTH_COMPONENT24, width, height), "overdraw depth");
+
+        gl_state().bindFramebuffer(FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, countTex, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "OVERDRAW: counting framebuffer is incomplete" << std::endl;
+    }
+
+    void release() {
+        if (countTex != 0) gl_state().deleteTextures(1, &countTex);
+        if (depthRBO != 0) gl_state().deleteRenderbuffers(1, &depthRBO);
+        countTex = depthRBO = 0;
+    }
+
+    OverdrawCounter(const OverdrawCounter&);
+    OverdrawCounter& operator=(const OverdrawCounter&);
+};
+
+#endif
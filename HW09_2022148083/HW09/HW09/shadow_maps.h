@@ -0,0 +1,396 @@
+#ifndef SHADOW_MAPS_H
+#define SHADOW_MAPS_H
+
+// Cached shadow maps for the directional light and the point lights.
+//      ShadowAtlas : one depth texture; square power-of-two tiles from a quadtree buddy allocator
+//      ShadowMap   : one tile + light view-projection, re-rendered only when dirty
+//      ShadowCaster: bounding sphere of a caster; version is bumped when it moves or changes
+//
+// The directional light uses SHADOW_CASCADES cascades. A point light uses 6 cube
+// faces (90 degree perspective tiles); the shader picks the face by the major axis.
+//
+// A map is dirty when its matrix changes or when a caster that was or is inside the
+// map's volume has a new version. Cascades are snapped across the light to whole
+// texels and along it to SHADOW_DEPTH_SNAP of their radius, so their matrix only
+// changes when the camera moves by a whole texel sideways or by a whole depth step
+// toward or away from the light. Idle frames render no shadow map.
+
+#include <shader_manager.h>
+#include <gl_state.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <cmath>
+
+#define SHADOW_CASCADES 3
+#define SHADOW_POINT_LIGHTS 1
+#define SHADOW_SPLIT_LAMBDA 0.75f       // 0: uniform cascade splits, 1: logarithmic
+#define SHADOW_CASTER_PULL 20.0f        // casters this far toward the light still cast into a cascade
+#define SHADOW_DEPTH_SNAP 0.25f         // cascade depth range moves in steps of this fraction of its radius
+#define SHADOW_POINT_NEAR 0.05f
+
+struct ShadowTile {
+    int x = 0, y = 0;
+    int size = 0;                       // 0: not allocated
+};
+
+// one depth texture shared by every shadow map
+class ShadowAtlas {
+public:
+    unsigned int texture = 0;
+    unsigned int FBO = 0;
+    int size;
+
+    ShadowAtlas(int size = 2048) {
+        this->size = size;
+        levels = 0;
+        while ((size >> levels) > 16) levels++;
+        freeBlocks.resize(levels + 1);
+        freeBlocks[0].push_back(glm::ivec2(0, 0));
+
+        glGenTextures(1, &texture);
+        gl_state().bindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        MEMORY_TRACK_TEXTURE(texture, texture_bytes(GL_DEPTH_COMPONENT24, size, size), MEMORY_RENDER_TARGET, "shadow atlas");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        // hardware depth compare: sampler2DShadow returns the filtered lit fraction
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+        glGenFramebuffers(1, &FBO);
+        gl_state().bindFramebuffer(FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "SHADOW: atlas framebuffer is incomplete" << std::endl;
+        gl_state().bindFramebuffer(0);
+    }
+
+    ~ShadowAtlas() {
+        gl_state().deleteFramebuffers(1, &FBO);
+        gl_state().deleteTextures(1, &texture);
+    }
+
+    // tileSize is rounded up to a power of two; returns false when the atlas is full
+    bool allocate(int tileSize, ShadowTile& tile) {
+        int level = levels;
+        while (level > 0 && (size >> level) < tileSize) level--;
+
+        // smallest free block that is large enough
+        int from = level;
+        while (from >= 0 && freeBlocks[from].empty()) from--;
+        if (from < 0) return false;
+
+        glm::ivec2 block = freeBlocks[from].back();
+        freeBlocks[from].pop_back();
+
+        // split down to the requested level, keeping the first quadrant
+        for (int l = from + 1; l <= level; l++) {
+            int s = size >> l;
+            freeBlocks[l].push_back(glm::ivec2(block.x + s, block.y));
+            freeBlocks[l].push_back(glm::ivec2(block.x, block.y + s));
+            freeBlocks[l].push_back(glm::ivec2(block.x + s, block.y + s));
+        }
+
+        tile.x = block.x;
+        tile.y = block.y;
+        tile.size = size >> level;
+        return true;
+    }
+
+    // return a tile, merging the four quadrants of a block once they are all free
+    void release(ShadowTile& tile) {
+        if (tile.size == 0) return;
+        int level = 0;
+        while ((size >> level) > tile.size) level++;
+
+        glm::ivec2 block(tile.x, tile.y);
+        tile.size = 0;
+        while (level > 0) {
+            int s = size >> level;
+            glm::ivec2 parent((block.x / (2 * s)) * 2 * s, (block.y / (2 * s)) * 2 * s);
+
+            // the other three quadrants of the parent must be free to merge
+            std::vector<glm::ivec2>& list = freeBlocks[level];
+            int found[3];
+            int n = 0;
+            for (int i = 0; i < (int)list.size() && n < 3; i++) {
+                bool inParent = list[i].x >= parent.x && list[i].x < parent.x + 2 * s &&
+                                list[i].y >= parent.y && list[i].y < parent.y + 2 * s;
+                if (inParent) found[n++] = i;
+            }
+            if (n < 3) break;
+
+            for (int k = 2; k >= 0; k--) {
+                list[found[k]] = list.back();
+                list.pop_back();
+            }
+            block = parent;
+            level--;
+        }
+        freeBlocks[level].push_back(block);
+    }
+
+private:
+    int levels;                                     // level l holds blocks of size >> l
+    std::vector<std::vector<glm::ivec2>> freeBlocks;
+
+    ShadowAtlas(const ShadowAtlas&);
+    ShadowAtlas& operator=(const ShadowAtlas&);
+};
+
+// something drawn into the shadow maps
+struct ShadowCaster {
+    glm::mat4 model = glm::mat4(1.0f);
+    glm::vec3 center = glm::vec3(0.0f);     // world space bounding sphere
+    float radius = 0.0f;
+    unsigned int version = 1;
+    std::function<void(ShaderProgram*)> draw;
+
+    // call every frame; the version changes only when the transform does
+    void update(const glm::mat4& model, const glm::vec3& localCenter, float localRadius) {
+        if (!(model == this->model)) {
+            this->model = model;
+            version++;
+        }
+        center = glm::vec3(model * glm::vec4(localCenter, 1.0f));
+        float scale = glm::max(glm::length(glm::vec3(model[0])),
+                      glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        radius = localRadius * scale;
+    }
+
+    // the mesh itself changed
+    void touch() {
+        version++;
+    }
+};
+
+// true unless the sphere is completely outside one of the frustum planes of viewProj
+inline bool sphere_in_frustum(const glm::mat4& viewProj, const glm::vec3& center, float radius) {
+    for (int axis = 0; axis < 3; axis++) {
+        for (int sign = -1; sign <= 1; sign += 2) {
+            // Gribb-Hartmann: plane = row 3 +/- row axis
+            glm::vec4 plane;
+            for (int c = 0; c < 4; c++)
+                plane[c] = viewProj[c][3] + sign * viewProj[c][axis];
+            float len = glm::length(glm::vec3(plane));
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius * len) return false;
+        }
+    }
+    return true;
+}
+
+class ShadowMap {
+public:
+    ShadowTile tile;
+    glm::mat4 lightViewProj = glm::mat4(0.0f);  // world -> light clip space
+    glm::mat4 atlasMatrix;                      // world -> atlas uv and depth
+    glm::vec4 atlasRect;                        // tile bounds in atlas uv, inset by one texel
+    bool dirty = true;
+
+    void setMatrix(const glm::mat4& viewProj, int atlasSize) {
+        if (viewProj == lightViewProj) return;
+        lightViewProj = viewProj;
+        dirty = true;
+
+        // clip [-1, 1] -> tile uv, depth [-1, 1] -> [0, 1]
+        float s = tile.size / (float)atlasSize;
+        glm::vec2 origin(tile.x / (float)atlasSize, tile.y / (float)atlasSize);
+        atlasMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(origin.x + 0.5f * s, origin.y + 0.5f * s, 0.5f)) *
+                      glm::scale(glm::mat4(1.0f), glm::vec3(0.5f * s, 0.5f * s, 0.5f)) * viewProj;
+        float texel = 1.0f / atlasSize;
+        atlasRect = glm::vec4(origin.x + texel, origin.y + texel, origin.x + s - texel, origin.y + s - texel);
+    }
+
+    // marks the map dirty when a caster entered, left or changed inside its volume
+    bool needsUpdate(const std::vector<ShadowCaster*>& casters) {
+        casterVersions.resize(casters.size(), 0);
+        for (size_t i = 0; i < casters.size() && !dirty; i++) {
+            bool inside = sphere_in_frustum(lightViewProj, casters[i]->center, casters[i]->radius);
+            if (inside ? casterVersions[i] != casters[i]->version : casterVersions[i] != 0)
+                dirty = true;
+        }
+        return dirty;
+    }
+
+    void render(ShaderProgram* depthShader, const std::vector<ShadowCaster*>& casters) {
+        gl_state().viewport(tile.x, tile.y, tile.size, tile.size);
+        gl_state().scissor(tile.x, tile.y, tile.size, tile.size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        depthShader->setMat4("lightViewProj", lightViewProj);
+        casterVersions.resize(casters.size(), 0);
+        for (size_t i = 0; i < casters.size(); i++) {
+            bool inside = sphere_in_frustum(lightViewProj, casters[i]->center, casters[i]->radius);
+            casterVersions[i] = inside ? casters[i]->version : 0;
+            if (!inside) continue;
+            depthShader->setMat4("model", casters[i]->model);
+            casters[i]->draw(depthShader);
+        }
+        dirty = false;
+    }
+
+private:
+    // version of each caster at the last render, 0 if it was outside the volume
+    std::vector<unsigned int> casterVersions;
+};
+
+class ShadowMaps {
+public:
+    ShadowAtlas atlas;
+    ShadowMap cascades[SHADOW_CASCADES];
+    float cascadeSplits[SHADOW_CASCADES];       // view space far distance of each cascade
+    ShadowMap pointFaces[SHADOW_POINT_LIGHTS][6];
+    ShaderProgram* depthShader;
+
+    // statistics
+    unsigned int mapsRendered = 0;
+    unsigned int mapsSkipped = 0;
+
+    ShadowMaps(ShaderProgram* depthShader, int atlasSize = 2048, int cascadeSize = 1024, int faceSize = 256)
+        : atlas(atlasSize) {
+        this->depthShader = depthShader;
+        for (int c = 0; c < SHADOW_CASCADES; c++) {
+            if (!atlas.allocate(cascadeSize, cascades[c].tile))
+                std::cout << "SHADOW: no atlas space for cascade " << c << std::endl;
+            cascadeSplits[c] = 0.0f;
+        }
+        for (int i = 0; i < SHADOW_POINT_LIGHTS; i++)
+            for (int f = 0; f < 6; f++)
+                if (!atlas.allocate(faceSize, pointFaces[i][f].tile))
+                    std::cout << "SHADOW: no atlas space for point light " << i << " face " << f << std::endl;
+    }
+
+    // fit the cascades to slices of the camera frustum up to shadowFar
+    void updateDirectional(const glm::vec3& direction, const glm::mat4& view, float fovy, float aspect, float zNear, float shadowFar) {
+        glm::mat4 invView = glm::inverse(view);
+        float tanY = tanf(fovy * 0.5f);
+        float tanX = tanY * aspect;
+        glm::vec3 dir = glm::normalize(direction);
+        glm::vec3 up = fabsf(dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), dir, up);
+
+        float sliceNear = zNear;
+        for (int c = 0; c < SHADOW_CASCADES; c++) {
+            float p = (c + 1) / (float)SHADOW_CASCADES;
+            float uniformSplit = zNear + (shadowFar - zNear) * p;
+            float logSplit = zNear * powf(shadowFar / zNear, p);
+            float sliceFar = glm::mix(uniformSplit, logSplit, SHADOW_SPLIT_LAMBDA);
+
+            // bounding sphere of the slice: its radius does not change when the camera rotates
+            glm::vec3 corners[8];
+            glm::vec3 center(0.0f);
+            for (int k = 0; k < 8; k++) {
+                float d = k < 4 ? sliceNear : sliceFar;
+                glm::vec4 corner((k & 1 ? 1.0f : -1.0f) * tanX * d, (k & 2 ? 1.0f : -1.0f) * tanY * d, -d, 1.0f);
+                corners[k] = glm::vec3(invView * corner);
+                center += corners[k];
+            }
+            center = center / 8.0f;
+            float radius = 0.0f;
+            for (int k = 0; k < 8; k++)
+                radius = glm::max(radius, glm::length(corners[k] - center));
+            radius = ceilf(radius * 16.0f) / 16.0f;
+
+            // snap the center to whole texels so the map does not change on sub-texel motion,
+            // and its depth to whole steps; the range grows by one step to still cover the slice
+            glm::vec3 lc = glm::vec3(lightView * glm::vec4(center, 1.0f));
+            float texel = 2.0f * radius / cascades[c].tile.size;
+            float depthStep = radius * SHADOW_DEPTH_SNAP;
+            lc.x = floorf(lc.x / texel) * texel;
+            lc.y = floorf(lc.y / texel) * texel;
+            lc.z = floorf(lc.z / depthStep) * depthStep;
+
+            glm::mat4 proj = glm::ortho(lc.x - radius, lc.x + radius, lc.y - radius, lc.y + radius,
+                                        -(lc.z + depthStep + radius + SHADOW_CASTER_PULL), -(lc.z - radius));
+            cascades[c].setMatrix(proj * lightView, atlas.size);
+            cascadeSplits[c] = sliceFar;
+            sliceNear = sliceFar;
+        }
+    }
+
+    // cube faces in the order +X, -X, +Y, -Y, +Z, -Z
+    void updatePoint(int light, const glm::vec3& position, float zFar) {
+        static const glm::vec3 dirs[6] = {
+            glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+            glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+            glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+        };
+        static const glm::vec3 ups[6] = {
+            glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+            glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+            glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+        };
+        glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, SHADOW_POINT_NEAR, zFar);
+        for (int f = 0; f < 6; f++)
+            pointFaces[light][f].setMatrix(proj * glm::lookAt(position, position + dirs[f], ups[f]), atlas.size);
+    }
+
+    // re-render the dirty maps; returns how many were rendered this frame
+    int render(const std::vector<ShadowCaster*>& casters, int screenWidth, int screenHeight) {
+        int rendered = 0;
+        bool bound = false;
+
+        ShadowMap* maps[SHADOW_CASCADES + SHADOW_POINT_LIGHTS * 6];
+        int count = 0;
+        for (int c = 0; c < SHADOW_CASCADES; c++) maps[count++] = &cascades[c];
+        for (int i = 0; i < SHADOW_POINT_LIGHTS; i++)
+            for (int f = 0; f < 6; f++) maps[count++] = &pointFaces[i][f];
+
+        for (int m = 0; m < count; m++) {
+            if (maps[m]->tile.size == 0 || !maps[m]->needsUpdate(casters)) {
+                mapsSkipped++;
+                continue;
+            }
+            if (!bound) {
+                gl_state().bindFramebuffer(atlas.FBO);
+                gl_state().enable(GL_SCISSOR_TEST);
+                gl_state().enable(GL_POLYGON_OFFSET_FILL);
+                glPolygonOffset(2.0f, 4.0f);
+                depthShader->use();
+                bound = true;
+            }
+            maps[m]->render(depthShader, casters);
+            rendered++;
+        }
+
+        if (bound) {
+            gl_state().disable(GL_POLYGON_OFFSET_FILL);
+            gl_state().disable(GL_SCISSOR_TEST);
+            gl_state().bindFramebuffer(0);
+            gl_state().viewport(0, 0, screenWidth, screenHeight);
+        }
+        mapsRendered += rendered;
+        return rendered;
+    }
+
+    // bind the atlas to `unit` and upload the matrices to the lighting shader (in use)
+    void apply(ShaderProgram* shader, int unit) {
+        gl_state().bindTextureUnit(unit, GL_TEXTURE_2D, atlas.texture);
+        shader->setInt("shadowAtlas", unit);
+        shader->setVec2("shadowTexelSize", glm::vec2(1.0f / atlas.size, 1.0f / atlas.size));
+
+        for (int c = 0; c < SHADOW_CASCADES; c++) {
+            std::string i = std::to_string(c);
+            shader->setMat4("cascadeMatrices[" + i + "]", cascades[c].atlasMatrix);
+            shader->setVec4("cascadeRects[" + i + "]", cascades[c].atlasRect);
+            shader->setFloat("cascadeSplits[" + i + "]", cascadeSplits[c]);
+        }
+        for (int l = 0; l < SHADOW_POINT_LIGHTS; l++) {
+            for (int f = 0; f < 6; f++) {
+                std::string i = std::to_string(l * 6 + f);
+                shader->setMat4("pointShadowMatrices[" + i + "]", pointFaces[l][f].atlasMatrix);
+                shader->setVec4("pointShadowRects[" + i + "]", pointFaces[l][f].atlasRect);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,34 @@
+#version 330 core
+// dynamic resolution: the rendered part of the scene target stretched over the window,
+// bilinear plus a contrast-adaptive sharpen limited to the neighbourhood min / max
+in vec2 ScreenUV;
+out vec4 FragColor;
+
+uniform sampler2D scene;
+uniform vec2 uvScale;           // rendered part of the target
+uniform vec2 texelSize;         // one texel of the target
+uniform float sharpness;        // 0: plain bilinear
+
+void main()
+{
+    // taps stay inside the rendered part: the rest of the target is stale
+    vec2 lo = 0.5 * texelSize;
+    vec2 hi = uvScale - 0.5 * texelSize;
+    vec2 uv = ScreenUV * uvScale;
+
+    vec3 c = texture(scene, clamp(uv, lo, hi)).rgb;
+    vec3 n = texture(scene, clamp(uv + vec2(0.0, texelSize.y), lo, hi)).rgb;
+    vec3 s = texture(scene, clamp(uv - vec2(0.0, texelSize.y), lo, hi)).rgb;
+    vec3 e = texture(scene, clamp(uv + vec2(texelSize.x, 0.0), lo, hi)).rgb;
+    vec3 w = texture(scene, clamp(uv - vec2(texelSize.x, 0.0), lo, hi)).rgb;
+
+    vec3 lowest = min(c, min(min(n, s), min(e, w)));
+    vec3 highest = max(c, max(max(n, s), max(e, w)));
+
+    // less sharpening where the neighbourhood already has high contrast
+    vec3 headroom = clamp(min(lowest, 1.0 - highest) / max(highest, vec3(1e-4)), 0.0, 1.0);
+    vec3 lobe = -sqrt(headroom) * (0.2 * sharpness);
+
+    vec3 result = (c + (n + s + e + w) * lobe) / (1.0 + 4.0 * lobe);
+    FragColor = vec4(clamp(result, lowest, highest), 1.0);
+}
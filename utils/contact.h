@@ -0,0 +1,50 @@
+#ifndef CONTACT_H
+#define CONTACT_H
+
+// Intersection of the HW04 quadratic curve Q: y = 2x^2 - 0.8x - 0.42
+// with the line segment L(t) = (a*t + b, c*t + d), 0 <= t <= 1.
+
+#include <cmath>
+
+// lineVer: segment end points (x0, y0, x1, y1)
+// interV : receives up to 2 intersection points (x, y, x, y)
+// returns the number of intersection points written to interV
+inline int quadratic_line_contact(const float lineVer[4], float interV[4]) {
+    float a = lineVer[2] - lineVer[0],
+          b = lineVer[0],
+          c = lineVer[3] - lineVer[1],
+          d = lineVer[1];
+    float A = float(pow(a, 2)) * 2.0f,
+          B = (4.0f * a * b) - (0.8f * a) - c,
+          C = (float(pow(b, 2)) * 2.0f) - (0.8f * b) - d - 0.42f;
+    float D = float(pow(B, 2)) - (4 * A * C);
+    int vindex = 0;
+    int nInter = 0;
+    if (D < 0) return 0;
+    if (D > 0) {
+        float t1 = (float(sqrt(D)) - B) / (2 * A),
+              t2 = (float(sqrt(D)) + B) / (2 * A);
+        t2 = -t2;
+        if (0 <= t1 && t1 <= 1) {
+            interV[vindex++] = a * t1 + b;
+            interV[vindex++] = c * t1 + d;
+            nInter++;
+        }
+        if (0 <= t2 && t2 <= 1) {
+            interV[vindex++] = a * t2 + b;
+            interV[vindex++] = c * t2 + d;
+            nInter++;
+        }
+    }
+    else if (D == 0) {
+        float t1 = B / (2 * A);
+        if (0 <= t1 && 1 <= t1) {
+            interV[vindex++] = a * t1 + b;
+            interV[vindex++] = c * t1 + d;
+            nInter++;
+        }
+    }
+    return nInter;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef DYNAMIC_BUFFER_H
+#define DYNAMIC_BUFFER_H
+
+// GL buffer object with capacity management for meshes that change at run time.
+//      - the buffer name never changes, so VAO attribute bindings stay valid
+//      - storage grows geometrically (x2) only when the data outgrows the capacity
+//      - otherwise only the byte range that differs from the last upload is sent
+//        with glBufferSubData
+//      - the storage and the CPU shadow copy are tracked by memory_tracker() under `tag`
+
+#include <GL/glew.h>
+#include <gl_state.h>
+#include <resource_manager.h>
+#include <vector>
+#include <cstring>
+
+class DynamicBuffer {
+public:
+    GLenum target;
+    unsigned int ID = 0;
+    size_t capacity = 0;            // bytes of GL storage
+    size_t size = 0;                // bytes in use
+    const char* tag;
+
+    // statistics
+    unsigned int reallocations = 0;
+    size_t bytesUploaded = 0;
+
+    DynamicBuffer(GLenum target = GL_ARRAY_BUFFER, const char* tag = "dynamic buffer") {
+        this->target = target;
+        this->tag = tag;
+    }
+
+    ~DynamicBuffer() {
+        release();
+    }
+
+    // the caller binds the VAO first when target is GL_ELEMENT_ARRAY_BUFFER
+    void upload(const void* data, size_t bytes) {
+        const unsigned char* src = (const unsigned char*)data;
+        if (ID == 0) ID = gl_names().buffer();
+        gl_state().bindBuffer(target, ID);
+
+        if (bytes > capacity) {
+            size_t newCapacity = capacity > 0 ? capacity * 2 : 256;
+            while (newCapacity < bytes) newCapacity *= 2;
+
+            glBufferData(target, newCapacity, NULL, GL_DYNAMIC_DRAW);
+            glBufferSubData(target, 0, bytes, src);
+            capacity = newCapacity;
+            reallocations++;
+            bytesUploaded += bytes;
+            shadow.assign(src, src + bytes);
+            MEMORY_TRACK_BUFFER(ID, capacity, buffer_category(target), tag);
+            MEMORY_TRACK_HOST(&shadow, shadow.capacity(), tag);
+        }
+        else {
+            // changed range [first, last) against the previous contents
+            size_t common = bytes < size ? bytes : size;
+            size_t first = 0;
+            while (first < common && shadow[first] == src[first]) first++;
+            size_t last = bytes;
+            if (bytes <= size) {
+                while (last > first && shadow[last - 1] == src[last - 1]) last--;
+            }
+
+            if (last > first) {
+                glBufferSubData(target, first, last - first, src + first);
+                bytesUploaded += last - first;
+            }
+            shadow.assign(src, src + bytes);
+        }
+        size = bytes;
+    }
+
+    void release() {
+        if (ID != 0) gl_state().deleteBuffers(1, &ID);
+        ID = 0;
+        capacity = size = 0;
+        shadow.clear();
+        MEMORY_RELEASE_HOST(&shadow);
+    }
+
+private:
+    // copy of the last upload, used to find the changed range
+    std::vector<unsigned char> shadow;
+
+    DynamicBuffer(const DynamicBuffer&);
+    DynamicBuffer& operator=(const DynamicBuffer&);
+};
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+// Render resolution that follows a GPU frame-time budget.
+//      DynamicResolution resolution(upscaleProgram);       // deferred_light.vs + upscale.fs
+//      resolution.budgetMs = 16.0f;
+//      ...
+//      resolution.beginFrame(SCR_WIDTH, SCR_HEIGHT);       // first GL call of the frame
+//      (passes with their own targets, e.g. shadow maps)
+//      resolution.bindTarget();                            // renderWidth x renderHeight
+//      (the scene)
+//      resolution.resolve();                               // upscaled into the window
+//
+// The scene is drawn into the lower left renderWidth x renderHeight of an offscreen
+// color + depth target of the window size. The target is only reallocated when the
+// window is resized, never when the scale changes.
+//
+// Each frame is timed on the GPU with GL_TIME_ELAPSED, from beginFrame() to resolve().
+// The result is read a few frames later, when it is available, so the CPU never waits
+// for it. The controller works on the rendered pixel count, which the fragment
+// lighting cost is proportional to. It is an incremental PI controller:
+//      error = (budget - gpu time) / budget
+//      area *= 1 + kp * (error - previous error) + ki * error
+// scale = sqrt(area), kept in [minScale, 1] and rounded to DYNAMIC_RESOLUTION_STEP so
+// the scale does not change every frame and the hi-z pyramid is not rebuilt every frame.
+// The clamp on area is the anti-windup.
+//
+// resolve() upscales with a bilinear fetch and a contrast-adaptive sharpen. The
+// negative lobe shrinks where the neighbourhood already spans the full range, and the
+// result is clamped to the neighbourhood min / max, so edges do not ring. Until the
+// upscale program is ready it falls back to a linear glBlitFramebuffer.
+//
+// Nothing is printed per step; near the budget the scale may dither between two steps.
+// The caller reports scale / gpuMs when asked.
+//
+// Disabled, bindTarget() binds the window at full size and resolve() only ends the
+// timer. The frame is then drawn as it was without this class.
+
+#include <GL/glew.h>
+#include <shader_manager.h>
+#include <gl_state.h>
+#include <iostream>
+#include <cmath>
+
+#define DYNAMIC_RESOLUTION_QUERIES 4    // frames a timer result may take to arrive
+#define DYNAMIC_RESOLUTION_STEP 0.05f
+
+class DynamicResolution {
+public:
+    bool enabled = true;
+    float budgetMs = 16.0f;
+    float minScale = 0.5f;
+    float kp = 0.6f, ki = 0.15f;
+    float sharpness = 0.5f;             // 0: plain bilinear
+
+    float scale = 1.0f;                 // of the window width and height, this frame
+    int width = 0, height = 0;          // window
+    int renderWidth = 0, renderHeight = 0;
+    float gpuMs = 0.0f;                 // latest measured frame
+
+    unsigned int FBO = 0;
+    unsigned int colorTex = 0, depthTex = 0;
+
+    explicit DynamicResolution(ShaderProgram* upscaleShader) {
+        this->upscaleShader = upscaleShader;
+        glGenFramebuffers(1, &FBO);
+        glGenVertexArrays(1, &VAO);
+        glGenQueries(DYNAMIC_RESOLUTION_QUERIES, queries);
+        for (int i = 0; i < DYNAMIC_RESOLUTION_QUERIES; i++) pending[i] = false;
+    }
+
+    ~DynamicResolution() {
+        releaseTarget();
+        gl_state().deleteFramebuffers(1, &FBO);
+        gl_state().deleteVertexArrays(1, &VAO);
+        glDeleteQueries(DYNAMIC_RESOLUTION_QUERIES, queries);
+    }
+
+    // reads the timers that finished, steps the controller and starts this frame's timer
+    void beginFrame(int width, int height) {
+        collect();
+        if (width != this->width || height != this->height) resize(width, height);
+
+        float applied = enabled ? scale : 1.0f;
+        renderWidth = (int)(width * applied + 0.5f);
+        renderHeight = (int)(height * applied + 0.5f);
+        if (renderWidth < 1) renderWidth = 1;
+        if (renderHeight < 1) renderHeight = 1;
+
+        timing = !pending[next];
+        if (timing) glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+    }
+
+    // the framebuffer the scene is drawn into
+    unsigned int framebuffer() const {
+        return enabled ? FBO : 0;
+    }
+
+    void bindTarget() {
+        gl_state().bindFramebuffer(framebuffer());
+        gl_state().viewport(0, 0, renderWidth, renderHeight);
+    }
+
+    // upscale into the window; leaves the window bound with a full viewport
+    void resolve() {
+        if (enabled) {
+            gl_state().bindFramebuffer(0);
+            gl_state().viewport(0, 0, width, height);
+            if (upscaleShader->ready()) {
+                gl_state().disable(GL_DEPTH_TEST);
+                upscaleShader->use();
+                upscaleShader->setInt("scene", 0);
+                upscaleShader->setVec2("uvScale", (float)renderWidth / width, (float)renderHeight / height);
+                upscaleShader->setVec2("texelSize", 1.0f / width, 1.0f / height);
+                bool scaled = renderWidth != width || renderHeight != height;
+                upscaleShader->setFloat("sharpness", scaled ? sharpness : 0.0f);
+                gl_state().bindTextureUnit(0, GL_TEXTURE_2D, colorTex);
+                gl_state().bindVertexArray(VAO);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                gl_state().enable(GL_DEPTH_TEST);
+            }
+            else {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+                glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);  // back to what the state cache holds
+            }
+        }
+        if (timing) {
+            glEndQuery(GL_TIME_ELAPSED);
+            pending[next] = true;
+            next = (next + 1) % DYNAMIC_RESOLUTION_QUERIES;
+        }
+    }
+
+private:
+    ShaderProgram* upscaleShader;
+    unsigned int VAO = 0;               // empty: the fullscreen triangle comes from gl_VertexID
+    unsigned int queries[DYNAMIC_RESOLUTION_QUERIES];
+    bool pending[DYNAMIC_RESOLUTION_QUERIES];
+    int next = 0;                       // query of the next frame
+    int oldest = 0;                     // oldest query that may be pending
+    bool timing = false;
+    float area = 1.0f;                  // controller output: scale squared, unrounded
+    float lastError = 0.0f;
+
+    // results arrive in submission order
+    void collect() {
+        while (pending[oldest]) {
+            GLint available = 0;
+            glGetQueryObjectiv(queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) break;
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[oldest], GL_QUERY_RESULT, &elapsed);
+            pending[oldest] = false;
+            oldest = (oldest + 1) % DYNAMIC_RESOLUTION_QUERIES;
+            gpuMs = elapsed / 1.0e6f;
+            if (enabled) control(gpuMs);
+        }
+    }
+
+    void control(float frameMs) {
+        float error = (budgetMs - frameMs) / budgetMs;
+        if (error < -1.0f) error = -1.0f;
+        float factor = 1.0f + kp * (error - lastError) + ki * error;
+        lastError = error;
+        if (factor < 0.5f) factor = 0.5f;
+        if (factor > 1.5f) factor = 1.5f;
+
+        area *= factor;
+        if (area < minScale * minScale) area = minScale * minScale;
+        if (area > 1.0f) area = 1.0f;
+
+        float stepped = floorf(sqrtf(area) / DYNAMIC_RESOLUTION_STEP + 0.5f) * DYNAMIC_RESOLUTION_STEP;
+        if (stepped < minScale) stepped = minScale;
+        if (stepped > 1.0f) stepped = 1.0f;
+        scale = stepped;
+    }
+
+    void resize(int width, int height) {
+        releaseTarget();
+        this->width = width;
+        this->height = height;
+        if (width <= 0 || height <= 0) return;
+
+        glGenTextures(1, &colorTex);
+        gl_state().bindTexture(GL_TEXTURE_2D, colorTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        MEMORY_TRACK_TEXTURE(colorTex, texture_bytes(GL_RGBA8, width, height), MEMORY_RENDER_TARGET, "scaled scene color");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenTextures(1, &depthTex);
+        gl_state().bindTexture(GL_TEXTURE_2D, depthTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        MEMORY_TRACK_TEXTURE(depthTex, texture_bytes(GL_DEPTH_COMPONENT24, width, height), MEMORY_RENDER_TARGET, "scaled scene depth");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        gl_state().bindFramebuffer(FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTex, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "RESOLUTION: scaled scene framebuffer is incomplete" << std::endl;
+        gl_state().bindFramebuffer(0);
+    }
+
+    void releaseTarget() {
+        unsigned int textures[2] = { colorTex, depthTex };
+        if (colorTex != 0) gl_state().deleteTextures(2, textures);
+        colorTex = depthTex = 0;
+    }
+
+    DynamicResolution(const DynamicResolution&);
+    DynamicResolution& operator=(const DynamicResolution&);
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef FRAME_LATENCY_H
+#define FRAME_LATENCY_H
+
+// Late-latched input and input-to-present latency.
+//      FrameLatency latency;
+//      while (!glfwWindowShouldClose(window)) {
+//          latency.wait();             // previous frame done on the GPU; input is polled meanwhile
+//          ...                         // work that does not depend on input
+//          latency.latch();            // last glfwPollEvents() of the frame
+//          ...                         // arcball matrices, draw
+//          glfwSwapBuffers(window);
+//          latency.presented();
+//      }
+//      latency.input();                // in every input callback
+//      latency.release();              // before glfwTerminate()
+//
+// The old loop, render() then glfwPollEvents(), drew with input polled before the
+// previous frame, and the driver could queue several frames behind it. Here at most
+// one frame is in flight, and input is read right before the matrices are built.
+//
+// With measuring on, presented() waits for the frame's fence and reports, once per
+// second, the time from the first input event a frame consumed to its completion.
+// "Presented" is when the GPU finished the frame including the swap; scanout
+// follows (within one refresh with vsync). An event is stamped when GLFW delivers it,
+// and wait() polls every millisecond, so the stamp is at most ~1 ms late.
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+
+class FrameLatency {
+public:
+    bool measuring = false;
+
+    // statistics since the last report
+    unsigned int samples = 0;
+    double total = 0.0, shortest = 1e30, longest = 0.0;
+    double latchTotal = 0.0;                // latch() to presented: the part the frame itself adds
+
+    FrameLatency() {}
+
+    // an instance is usually a global, destroyed after glfwTerminate(): no GL here
+    ~FrameLatency() {}
+
+    // delete the fence while the context is still current
+    void release() {
+        if (fence != 0) glDeleteSync(fence);
+        fence = 0;
+    }
+
+    // block until the previous frame has finished, handling input while waiting
+    void wait() {
+        if (fence == 0) return;
+        for (;;) {
+            GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);   // 1 ms
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+            glfwPollEvents();
+        }
+        glDeleteSync(fence);
+        fence = 0;
+    }
+
+    // the input this frame is built from
+    void latch() {
+        glfwPollEvents();
+        latchTime = glfwGetTime();
+        latchedInput = pendingInput;
+        pendingInput = -1.0;
+    }
+
+    // an input event arrived; the frame that latches it measures from here
+    void input() {
+        if (pendingInput < 0.0) pendingInput = glfwGetTime();
+    }
+
+    // after glfwSwapBuffers()
+    void presented() {
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        if (!measuring || latchedInput < 0.0) return;
+
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);                    // 1 s
+        double now = glfwGetTime();
+        double latency = now - latchedInput;
+        total += latency;
+        latchTotal += now - latchTime;
+        if (latency < shortest) shortest = latency;
+        if (latency > longest) longest = latency;
+        samples++;
+        latchedInput = -1.0;
+
+        if (now - lastReport >= 1.0) {
+            report();
+            lastReport = now;
+        }
+    }
+
+    void setMeasuring(bool on) {
+        measuring = on;
+        reset();
+        lastReport = glfwGetTime();
+    }
+
+    void report() {
+        if (samples == 0) return;
+        std::cout << "LATENCY: input to present " << total / samples * 1000.0 << " ms average ("
+                  << shortest * 1000.0 << " - " << longest * 1000.0 << " ms), latch to present "
+                  << latchTotal / samples * 1000.0 << " ms, " << samples << " frames with input" << std::endl;
+        reset();
+    }
+
+private:
+    GLsync fence = 0;
+    double pendingInput = -1.0;             // first event not latched yet
+    double latchedInput = -1.0;             // first event of the frame being built
+    double latchTime = 0.0;
+    double lastReport = 0.0;
+
+    void reset() {
+        samples = 0;
+        total = latchTotal = longest = 0.0;
+        shortest = 1e30;
+    }
+
+    FrameLatency(const FrameLatency&);
+    FrameLatency& operator=(const FrameLatency&);
+};
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+// Shared geometry arena: every mesh of one vertex format lives in a single
+// VBO/EBO pair behind a single VAO, at its own vertex and index range.
+//      GeometryArena<Format> arena(GL_UNSIGNED_SHORT);
+//      MeshRange range = arena.allocate(vertices, indices);  // indices relative to the mesh
+//      arena.upload();                                        // sends only what changed
+//
+//      IndirectBatch batch;
+//      batch.add(range, model);  ...
+//      batch.submit(arena.VAO, arena.indexType, shader, IndirectBatch::supported());
+//
+// With GL_ARB_multi_draw_indirect + GL_ARB_shader_draw_parameters + SSBOs the whole
+// batch is one glMultiDrawElementsIndirect; the vertex shader reads its model matrix
+// from the SSBO at binding DRAW_DATA_BINDING with gl_DrawIDARB. Otherwise every
+// command becomes a glDrawElementsBaseVertex with the "model" uniform, still
+// without a VAO switch.
+//
+// One index type for every mesh in the arena, chosen when it is created. Indices are
+// relative to the mesh's first vertex (baseVertex), so GL_UNSIGNED_SHORT holds any mesh of
+// up to 0xFFFF vertices however large the arena grows; a larger mesh is refused with a
+// message and gets an empty range.
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <dynamic_buffer.h>
+#include <shader_manager.h>
+#include <gl_state.h>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#define DRAW_DATA_BINDING 0
+
+struct MeshRange {
+    unsigned int firstVertex = 0, vertexCount = 0;
+    unsigned int firstIndex = 0, indexCount = 0;
+};
+
+// layout fixed by GL for GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// first-fit suballocation of [0, end) with coalescing free spans
+class SpanAllocator {
+public:
+    unsigned int end = 0;
+
+    unsigned int allocate(unsigned int count) {
+        for (size_t i = 0; i < free.size(); i++) {
+            if (free[i].count < count) continue;
+            unsigned int first = free[i].first;
+            free[i].first += count;
+            free[i].count -= count;
+            if (free[i].count == 0) free.erase(free.begin() + i);
+            return first;
+        }
+        unsigned int first = end;
+        end += count;
+        return first;
+    }
+
+    void release(unsigned int first, unsigned int count) {
+        if (count == 0) return;
+        size_t i = 0;
+        while (i < free.size() && free[i].first < first) i++;
+        free.insert(free.begin() + i, Span{ first, count });
+        if (i + 1 < free.size() && free[i].first + free[i].count == free[i + 1].first) {
+            free[i].count += free[i + 1].count;
+            free.erase(free.begin() + i + 1);
+        }
+        if (i > 0 && free[i - 1].first + free[i - 1].count == free[i].first) {
+            free[i - 1].count += free[i].count;
+            free.erase(free.begin() + i);
+        }
+        // a free span at the end just shortens the arena
+        if (!free.empty() && free.back().first + free.back().count == end) {
+            end = free.back().first;
+            free.pop_back();
+        }
+    }
+
+private:
+    struct Span {
+        unsigned int first, count;
+    };
+    std::vector<Span> free;
+};
+
+template <typename Format>
+class GeometryArena {
+public:
+    typedef typename Format::Vertex Vertex;
+
+    unsigned int VAO = 0;
+    DynamicBuffer vertexBuffer{ GL_ARRAY_BUFFER, "geometry arena vertices" };
+    DynamicBuffer indexBuffer{ GL_ELEMENT_ARRAY_BUFFER, "geometry arena indices" };
+
+    // CPU copy of the buffers; upload() sends the byte range that changed
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    unsigned int meshes = 0;
+    GLenum indexType;                       // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+
+    explicit GeometryArena(GLenum indexType = GL_UNSIGNED_INT) : indexType(indexType) {
+        VAO = gl_names().vertexArray();
+    }
+
+    ~GeometryArena() {
+        gl_state().deleteVertexArrays(1, &VAO);
+    }
+
+    // bytes per index in the element buffer
+    size_t indexSize() const {
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    }
+
+    MeshRange allocate(const std::vector<Vertex>& meshVertices, const std::vector<unsigned int>& meshIndices) {
+        MeshRange range;
+        if (indexType == GL_UNSIGNED_SHORT && meshVertices.size() > 0xFFFF) {
+            std::cout << "GEOMETRY: a mesh of " << meshVertices.size() << " vertices does not fit 16 bit indices" << std::endl;
+            return range;
+        }
+        range.vertexCount = (unsigned int)meshVertices.size();
+        range.indexCount = (unsigned int)meshIndices.size();
+        range.firstVertex = vertexSpans.allocate(range.vertexCount);
+        range.firstIndex = indexSpans.allocate(range.indexCount);
+        write(range, meshVertices, meshIndices);
+        meshes++;
+        return range;
+    }
+
+    void release(MeshRange& range) {
+        if (range.vertexCount == 0 && range.indexCount == 0) return;
+        vertexSpans.release(range.firstVertex, range.vertexCount);
+        indexSpans.release(range.firstIndex, range.indexCount);
+        vertices.resize(vertexSpans.end);
+        indices.resize(indexSpans.end);
+        range = MeshRange();
+        meshes--;
+    }
+
+    // replace a mesh: in place when it is not larger, otherwise moved to a new range
+    MeshRange update(const MeshRange& range, const std::vector<Vertex>& meshVertices, const std::vector<unsigned int>& meshIndices) {
+        if (meshVertices.size() <= range.vertexCount && meshIndices.size() <= range.indexCount) {
+            MeshRange shrunk = range;
+            shrunk.vertexCount = (unsigned int)meshVertices.size();
+            shrunk.indexCount = (unsigned int)meshIndices.size();
+            vertexSpans.release(range.firstVertex + shrunk.vertexCount, range.vertexCount - shrunk.vertexCount);
+            indexSpans.release(range.firstIndex + shrunk.indexCount, range.indexCount - shrunk.indexCount);
+            write(shrunk, meshVertices, meshIndices);
+            return shrunk;
+        }
+        MeshRange old = range;
+        release(old);
+        return allocate(meshVertices, meshIndices);
+    }
+
+    // sync the GL buffers with the CPU copy; the attribute setup happens once
+    void upload() {
+        gl_state().bindVertexArray(VAO);
+        bool created = (vertexBuffer.ID == 0);
+        vertexBuffer.upload(vertices.data(), vertices.size() * sizeof(Vertex));
+        if (indexType == GL_UNSIGNED_SHORT) {
+            shortIndices.assign(indices.begin(), indices.end());
+            indexBuffer.upload(shortIndices.data(), shortIndices.size() * sizeof(unsigned short));
+        }
+        else indexBuffer.upload(indices.data(), indices.size() * sizeof(unsigned int));
+        if (created) Format::setup();
+    }
+
+private:
+    SpanAllocator vertexSpans, indexSpans;
+    std::vector<unsigned short> shortIndices;   // upload copy of indices for GL_UNSIGNED_SHORT
+
+    void write(const MeshRange& range, const std::vector<Vertex>& meshVertices, const std::vector<unsigned int>& meshIndices) {
+        vertices.resize(vertexSpans.end);
+        indices.resize(indexSpans.end);
+        std::copy(meshVertices.begin(), meshVertices.end(), vertices.begin() + range.firstVertex);
+        std::copy(meshIndices.begin(), meshIndices.end(), indices.begin() + range.firstIndex);
+    }
+
+    GeometryArena(const GeometryArena&);
+    GeometryArena& operator=(const GeometryArena&);
+};
+
+class IndirectBatch {
+public:
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<glm::mat4> models;          // per draw, std430 mat4[] at DRAW_DATA_BINDING
+    unsigned int indirectBuffer = 0, drawDataBuffer = 0;
+
+    // statistics of the last submit()
+    unsigned int drawCalls = 0;
+
+    // multi draw indirect with gl_DrawIDARB and SSBOs is available
+    static bool supported() {
+        return GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_draw_parameters
+            && GLEW_ARB_shader_storage_buffer_object;
+    }
+
+    IndirectBatch() {
+        if (supported()) {
+            indirectBuffer = gl_names().buffer();
+            drawDataBuffer = gl_names().buffer();
+        }
+    }
+
+    ~IndirectBatch() {
+        if (indirectBuffer != 0) gl_state().deleteBuffers(1, &indirectBuffer);
+        if (drawDataBuffer != 0) gl_state().deleteBuffers(1, &drawDataBuffer);
+    }
+
+    void clear() {
+        commands.clear();
+        models.clear();
+    }
+
+    void add(const MeshRange& range, const glm::mat4& model) {
+        DrawElementsIndirectCommand command;
+        command.count = range.indexCount;
+        command.instanceCount = 1;
+        command.firstIndex = range.firstIndex;
+        command.baseVertex = (GLint)range.firstVertex;
+        command.baseInstance = 0;
+        commands.push_back(command);
+        models.push_back(model);
+    }
+
+    // multiDraw: shader reads models[gl_DrawIDARB]; otherwise it has a "model" uniform.
+    // indexType: the arena's
+    void submit(unsigned int VAO, GLenum indexType, ShaderProgram* shader, bool multiDraw) {
+        gl_state().bindVertexArray(VAO);
+        drawCalls = 0;
+        if (commands.empty()) return;
+
+        if (multiDraw && indirectBuffer != 0) {
+            // orphaned every frame: the driver renames the storage instead of waiting for the GPU
+            gl_state().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand),
+                         commands.data(), GL_STREAM_DRAW);
+            MEMORY_TRACK_BUFFER(indirectBuffer, commands.size() * sizeof(DrawElementsIndirectCommand), MEMORY_BUFFER, "indirect commands");
+            gl_state().bindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, models.size() * sizeof(glm::mat4), models.data(), GL_STREAM_DRAW);
+            MEMORY_TRACK_BUFFER(drawDataBuffer, models.size() * sizeof(glm::mat4), MEMORY_BUFFER, "indirect draw data");
+            gl_state().bindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, drawDataBuffer);
+
+            glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, 0, (GLsizei)commands.size(), 0);
+            drawCalls = 1;
+            return;
+        }
+
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+        for (size_t i = 0; i < commands.size(); i++) {
+            shader->setMat4("model", models[i]);
+            glDrawElementsBaseVertex(GL_TRIANGLES, commands[i].count, indexType,
+                                     (void*)(commands[i].firstIndex * indexSize), commands[i].baseVertex);
+            drawCalls++;
+        }
+    }
+
+private:
+    IndirectBatch(const IndirectBatch&);
+    IndirectBatch& operator=(const IndirectBatch&);
+};
+
+#endif
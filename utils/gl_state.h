@@ -0,0 +1,319 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+// Redundant state filter in front of GL.
+//      gl_state().useProgram(ID);          // only reaches GL when the program changes
+//      gl_state().bindVertexArray(VAO);
+//      ...
+//      gl_state().endFrame();              // issued / filtered counts of the frame
+//
+// Tracked: program, VAO, buffers, the first GL_STATE_INDEXED_BINDINGS uniform and
+// shader storage binding points, framebuffer, texture units (2D, 2D array, cube map,
+// 3D), the usual enable caps, blend func, depth func/mask, color mask, polygon mode,
+// viewport and scissor. Anything else goes straight through.
+//
+// Code that calls GL directly (e.g. Shader::use(), Cube::draw()) must be followed
+// by invalidate(), and objects must be deleted through the cache so a recycled
+// name is not mistaken for the one still bound. Deleting through the cache also
+// releases the names' memory_tracker() records.
+
+#include <GL/glew.h>
+#include <memory_tracker.h>
+
+#define GL_STATE_UNKNOWN 0xFFFFFFFFu
+#define GL_STATE_TEXTURE_UNITS 32
+#define GL_STATE_INDEXED_BINDINGS 16
+
+class GLState {
+public:
+    // calls that reached GL / calls dropped as redundant
+    unsigned int issued = 0, filtered = 0;
+    unsigned int lastIssued = 0, lastFiltered = 0;      // previous frame
+
+    GLState() {
+        invalidate();
+    }
+
+    // forget everything: the next call of each kind reaches GL
+    void invalidate() {
+        program = vertexArray = framebuffer = GL_STATE_UNKNOWN;
+        for (int i = 0; i < BUFFER_TARGETS; i++) buffers[i] = GL_STATE_UNKNOWN;
+        for (int t = 0; t < INDEXED_TARGETS; t++)
+            for (int i = 0; i < GL_STATE_INDEXED_BINDINGS; i++) indexedBuffers[t][i] = GL_STATE_UNKNOWN;
+        activeUnit = GL_STATE_UNKNOWN;
+        for (int u = 0; u < GL_STATE_TEXTURE_UNITS; u++)
+            for (int t = 0; t < TEXTURE_TARGETS; t++) textures[u][t] = GL_STATE_UNKNOWN;
+        for (int i = 0; i < CAPS; i++) caps[i] = -1;
+        // 0 is GL_ZERO, a valid blend factor: unknown must be a value no call passes
+        blendSrc = blendDst = depthFunction = polygonModeValue = GL_STATE_UNKNOWN;
+        depthWrite = -1;
+        colorWrite = -1;
+        viewportRect[0] = scissorRect[0] = -1;
+        viewportRect[2] = scissorRect[2] = -1;
+    }
+
+    void endFrame() {
+        lastIssued = issued;
+        lastFiltered = filtered;
+        issued = filtered = 0;
+    }
+
+    void useProgram(GLuint id) {
+        if (check(program, id)) glUseProgram(id);
+    }
+
+    // the element buffer binding belongs to the VAO, so it is forgotten on a VAO change
+    void bindVertexArray(GLuint id) {
+        if (check(vertexArray, id)) {
+            glBindVertexArray(id);
+            buffers[bufferIndex(GL_ELEMENT_ARRAY_BUFFER)] = GL_STATE_UNKNOWN;
+        }
+    }
+
+    void bindBuffer(GLenum target, GLuint id) {
+        int i = bufferIndex(target);
+        if (i < 0) {
+            issued++;
+            glBindBuffer(target, id);
+        }
+        else if (check(buffers[i], id)) glBindBuffer(target, id);
+    }
+
+    // binds the indexed binding point and, like GL, the generic binding of target
+    void bindBufferBase(GLenum target, GLuint index, GLuint id) {
+        int t = indexedIndex(target);
+        if (t < 0 || index >= GL_STATE_INDEXED_BINDINGS) issued++;
+        else if (!check(indexedBuffers[t][index], id)) return;
+        glBindBufferBase(target, index, id);
+        int i = bufferIndex(target);
+        if (i >= 0) buffers[i] = id;
+    }
+
+    // GL_FRAMEBUFFER (draw and read)
+    void bindFramebuffer(GLuint id) {
+        if (check(framebuffer, id)) glBindFramebuffer(GL_FRAMEBUFFER, id);
+    }
+
+    void activeTexture(GLenum unit) {
+        if (check(activeUnit, unit - GL_TEXTURE0)) glActiveTexture(unit);
+    }
+
+    // like glBindTexture: binds to the active unit
+    void bindTexture(GLenum target, GLuint id) {
+        int t = textureIndex(target);
+        if (t < 0 || activeUnit >= GL_STATE_TEXTURE_UNITS) {
+            issued++;
+            glBindTexture(target, id);
+            if (t >= 0) forgetTexture(target);
+        }
+        else if (check(textures[activeUnit][t], id)) glBindTexture(target, id);
+    }
+
+    void bindTextureUnit(int unit, GLenum target, GLuint id) {
+        activeTexture(GL_TEXTURE0 + unit);
+        bindTexture(target, id);
+    }
+
+    void enable(GLenum cap) {
+        setCap(cap, true);
+    }
+
+    void disable(GLenum cap) {
+        setCap(cap, false);
+    }
+
+    void blendFunc(GLenum src, GLenum dst) {
+        if (blendSrc == src && blendDst == dst) {
+            filtered++;
+            return;
+        }
+        blendSrc = src;
+        blendDst = dst;
+        issued++;
+        glBlendFunc(src, dst);
+    }
+
+    void depthFunc(GLenum func) {
+        if (check(depthFunction, func)) glDepthFunc(func);
+    }
+
+    void depthMask(GLboolean flag) {
+        if (check(depthWrite, flag ? 1 : 0)) glDepthMask(flag);
+    }
+
+    void colorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) {
+        int mask = (r ? 1 : 0) | (g ? 2 : 0) | (b ? 4 : 0) | (a ? 8 : 0);
+        if (check(colorWrite, mask)) glColorMask(r, g, b, a);
+    }
+
+    // GL_FRONT_AND_BACK, the only face core profile accepts
+    void polygonMode(GLenum mode) {
+        if (check(polygonModeValue, mode)) glPolygonMode(GL_FRONT_AND_BACK, mode);
+    }
+
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+        if (checkRect(viewportRect, x, y, width, height)) glViewport(x, y, width, height);
+    }
+
+    // ARB_viewport_array; viewport 0 is the one viewport() sets, so its cached rect is dropped
+    void viewportArray(GLuint first, GLsizei count, const GLfloat* rects) {
+        if (first == 0 && count > 0) viewportRect[0] = -1;
+        issued++;
+        glViewportArrayv(first, count, rects);
+    }
+
+    void scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+        if (checkRect(scissorRect, x, y, width, height)) glScissor(x, y, width, height);
+    }
+
+    // deleting a bound object resets its binding to 0 in GL; keep the cache in step
+    void deleteProgram(GLuint id) {
+        if (program == id) program = 0;
+        glDeleteProgram(id);
+    }
+
+    void deleteVertexArrays(GLsizei n, const GLuint* ids) {
+        for (GLsizei i = 0; i < n; i++)
+            if (vertexArray == ids[i]) vertexArray = 0;
+        glDeleteVertexArrays(n, ids);
+    }
+
+    void deleteBuffers(GLsizei n, const GLuint* ids) {
+        for (GLsizei i = 0; i < n; i++)
+            for (int b = 0; b < BUFFER_TARGETS; b++)
+                if (buffers[b] == ids[i]) buffers[b] = 0;
+        for (GLsizei i = 0; i < n; i++)
+            for (int t = 0; t < INDEXED_TARGETS; t++)
+                for (int b = 0; b < GL_STATE_INDEXED_BINDINGS; b++)
+                    if (indexedBuffers[t][b] == ids[i]) indexedBuffers[t][b] = 0;
+        memory_tracker().release(MEMORY_GL_BUFFER, n, ids);
+        glDeleteBuffers(n, ids);
+    }
+
+    void deleteTextures(GLsizei n, const GLuint* ids) {
+        for (GLsizei i = 0; i < n; i++)
+            for (int u = 0; u < GL_STATE_TEXTURE_UNITS; u++)
+                for (int t = 0; t < TEXTURE_TARGETS; t++)
+                    if (textures[u][t] == ids[i]) textures[u][t] = 0;
+        memory_tracker().release(MEMORY_GL_TEXTURE, n, ids);
+        glDeleteTextures(n, ids);
+    }
+
+    void deleteFramebuffers(GLsizei n, const GLuint* ids) {
+        for (GLsizei i = 0; i < n; i++)
+            if (framebuffer == ids[i]) framebuffer = 0;
+        glDeleteFramebuffers(n, ids);
+    }
+
+    // renderbuffer bindings are not cached; only the memory records are kept in step
+    void deleteRenderbuffers(GLsizei n, const GLuint* ids) {
+        memory_tracker().release(MEMORY_GL_RENDERBUFFER, n, ids);
+        glDeleteRenderbuffers(n, ids);
+    }
+
+private:
+    enum { BUFFER_TARGETS = 9, INDEXED_TARGETS = 2, TEXTURE_TARGETS = 4, CAPS = 6 };
+
+    GLuint program, vertexArray, framebuffer;
+    GLuint buffers[BUFFER_TARGETS];
+    GLuint indexedBuffers[INDEXED_TARGETS][GL_STATE_INDEXED_BINDINGS];
+    GLuint activeUnit;
+    GLuint textures[GL_STATE_TEXTURE_UNITS][TEXTURE_TARGETS];
+    int caps[CAPS];                         // -1 unknown, 0 disabled, 1 enabled
+    GLenum blendSrc, blendDst, depthFunction, polygonModeValue;
+    int depthWrite, colorWrite;
+    GLint viewportRect[4], scissorRect[4];
+
+    // true (and remembered) when value differs from the cached one
+    template <typename T, typename U> bool check(T& cached, U value) {
+        if (cached == (T)value) {
+            filtered++;
+            return false;
+        }
+        cached = (T)value;
+        issued++;
+        return true;
+    }
+
+    bool checkRect(GLint* rect, GLint x, GLint y, GLsizei width, GLsizei height) {
+        if (rect[0] == x && rect[1] == y && rect[2] == width && rect[3] == height) {
+            filtered++;
+            return false;
+        }
+        rect[0] = x; rect[1] = y; rect[2] = width; rect[3] = height;
+        issued++;
+        return true;
+    }
+
+    void setCap(GLenum cap, bool on) {
+        int i = capIndex(cap);
+        if (i < 0) {
+            issued++;
+            if (on) glEnable(cap);
+            else glDisable(cap);
+        }
+        else if (check(caps[i], on ? 1 : 0)) {
+            if (on) glEnable(cap);
+            else glDisable(cap);
+        }
+    }
+
+    // a binding on an unknown unit: that target is unknown on every unit
+    void forgetTexture(GLenum target) {
+        int t = textureIndex(target);
+        for (int u = 0; u < GL_STATE_TEXTURE_UNITS; u++) textures[u][t] = GL_STATE_UNKNOWN;
+    }
+
+    static int bufferIndex(GLenum target) {
+        switch (target) {
+        case GL_ARRAY_BUFFER: return 0;
+        case GL_ELEMENT_ARRAY_BUFFER: return 1;
+        case GL_UNIFORM_BUFFER: return 2;
+        case GL_COPY_READ_BUFFER: return 3;
+        case GL_COPY_WRITE_BUFFER: return 4;
+        case GL_PIXEL_PACK_BUFFER: return 5;
+        case GL_PIXEL_UNPACK_BUFFER: return 6;
+        case GL_DRAW_INDIRECT_BUFFER: return 7;
+        case GL_SHADER_STORAGE_BUFFER: return 8;
+        default: return -1;
+        }
+    }
+
+    static int indexedIndex(GLenum target) {
+        switch (target) {
+        case GL_UNIFORM_BUFFER: return 0;
+        case GL_SHADER_STORAGE_BUFFER: return 1;
+        default: return -1;
+        }
+    }
+
+    static int textureIndex(GLenum target) {
+        switch (target) {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_2D_ARRAY: return 1;
+        case GL_TEXTURE_CUBE_MAP: return 2;
+        case GL_TEXTURE_3D: return 3;
+        default: return -1;
+        }
+    }
+
+    static int capIndex(GLenum cap) {
+        switch (cap) {
+        case GL_BLEND: return 0;
+        case GL_DEPTH_TEST: return 1;
+        case GL_SCISSOR_TEST: return 2;
+        case GL_CULL_FACE: return 3;
+        case GL_POLYGON_OFFSET_FILL: return 4;
+        case GL_STENCIL_TEST: return 5;
+        default: return -1;
+        }
+    }
+};
+
+// the cache of the current context (all programs here use one context for drawing)
+inline GLState& gl_state() {
+    static GLState state;
+    return state;
+}
+
+#endif
@@ -0,0 +1,396 @@
+#ifndef GPU_CULLING_H
+#define GPU_CULLING_H
+
+// GPU-driven culling: a compute pass tests every instance against the frustum and a
+// hierarchical-Z pyramid of the previous frame and compacts the survivors into an
+// indirect command buffer; the CPU never learns which instances were drawn.
+//      GpuCuller culler(cullProgram, hizProgram);         // cull_instances.comp, hiz_build.comp
+//      culler.attachDrawIndex(arena.VAO);                  // once per VAO
+//      culler.setInstances(instances);                     // when the instance set changes
+//      ...
+//      culler.cull(projection * view);                     // compute: commands + model matrices
+//      culler.draw(arena.VAO, arena.indexType);            // one indirect multi-draw
+//      culler.buildHiZ(projection * view, width, height);  // after the occluders, for the next frame
+//
+// The compute pass writes the model matrices at CULL_MODEL_BINDING; draw() binds the same
+// buffer at DRAW_DATA_BINDING, where the vertex shader reads models[aDrawIndex]: aDrawIndex
+// is a per-instance attribute 0, 1, 2, ... and every command's baseInstance is its
+// compacted index, so no GL_ARB_shader_draw_parameters is needed.
+// With GL_ARB_indirect_parameters the draw count comes from the GPU counter; otherwise
+// all instanceCount commands are submitted and the unused tail has zero indices.
+//
+// The pyramid is one frame old: an object that was hidden last frame and is uncovered
+// now appears one frame late.
+//
+// verify() culls the current instance set against the frustum only, reads the commands
+// and models back and compares them with the same test on the CPU. It stalls, so it is
+// for a key press, not for every frame.
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <shader_manager.h>
+#include <geometry_arena.h>
+#include <gl_state.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cmath>
+
+// bindings of cull_instances.comp; the draw reads the models at DRAW_DATA_BINDING
+#define CULL_INSTANCE_BINDING 0
+#define CULL_COMMAND_BINDING 1
+#define CULL_MODEL_BINDING 2
+#define CULL_COUNTER_BINDING 3
+#define CULL_DRAW_INDEX_LOCATION 4
+#define CULL_HIZ_TEXTURE_UNIT 7
+
+// std430 layout of cull_instances.comp's Instance
+struct CullInstance {
+    glm::mat4 model;
+    glm::vec4 sphere;                       // bounding sphere before model: center, radius
+    GLuint count, firstIndex;               // index range in the arena
+    GLint baseVertex;
+    GLuint pad;
+};
+
+inline CullInstance cull_instance(const MeshRange& range, const glm::mat4& model, const glm::vec4& sphere) {
+    CullInstance instance;
+    instance.model = model;
+    instance.sphere = sphere;
+    instance.count = range.indexCount;
+    instance.firstIndex = range.firstIndex;
+    instance.baseVertex = (GLint)range.firstVertex;
+    instance.pad = 0;
+    return instance;
+}
+
+class GpuCuller {
+public:
+    ShaderProgram* cullProgram;
+    ShaderProgram* hizProgram;
+    unsigned int instanceBuffer = 0, commandBuffer = 0, drawDataBuffer = 0, counterBuffer = 0;
+    unsigned int drawIndexBuffer = 0;
+    unsigned int instanceCount = 0;
+    bool occlusion = true;
+
+    // hierarchical-Z: copy of the window depth and its R32F max pyramid
+    unsigned int depthTexture = 0, hizTexture = 0;
+    int hizWidth = 0, hizHeight = 0, hizLevels = 0;
+    glm::mat4 hizViewProj = glm::mat4(1.0f);
+    bool hizValid = false;
+
+    // compute, SSBOs, multi draw indirect, base instance and buffer clears: GL 4.3
+    static bool supported() {
+        return GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object
+            && GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance && GLEW_ARB_clear_buffer_object
+            && GLEW_ARB_shader_image_load_store && GLEW_ARB_texture_storage);
+    }
+
+    GpuCuller(ShaderProgram* cullProgram, ShaderProgram* hizProgram) {
+        this->cullProgram = cullProgram;
+        this->hizProgram = hizProgram;
+        unsigned int buffers[5];
+        glGenBuffers(5, buffers);
+        instanceBuffer = buffers[0];
+        commandBuffer = buffers[1];
+        drawDataBuffer = buffers[2];
+        counterBuffer = buffers[3];
+        drawIndexBuffer = buffers[4];
+
+        GLuint zero = 0;
+        gl_state().bindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), &zero, GL_DYNAMIC_DRAW);
+        MEMORY_TRACK_BUFFER(counterBuffer, sizeof(GLuint), MEMORY_BUFFER, "cull counter");
+    }
+
+    ~GpuCuller() {
+        unsigned int buffers[5] = { instanceBuffer, commandBuffer, drawDataBuffer, counterBuffer, drawIndexBuffer };
+        gl_state().deleteBuffers(5, buffers);
+        releaseHiZ();
+    }
+
+    // per-instance draw index at CULL_DRAW_INDEX_LOCATION of a VAO drawn by draw()
+    void attachDrawIndex(unsigned int VAO) {
+        gl_state().bindVertexArray(VAO);
+        gl_state().bindBuffer(GL_ARRAY_BUFFER, drawIndexBuffer);
+        glVertexAttribIPointer(CULL_DRAW_INDEX_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+        glEnableVertexAttribArray(CULL_DRAW_INDEX_LOCATION);
+        glVertexAttribDivisor(CULL_DRAW_INDEX_LOCATION, 1);
+    }
+
+    // replace the instance set; the output buffers grow with it
+    void setInstances(const std::vector<CullInstance>& instances) {
+        bool grown = instances.size() > capacity;
+        instanceCount = (unsigned int)instances.size();
+        if (grown) {
+            capacity = instances.size();
+            gl_state().bindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(CullInstance), NULL, GL_DYNAMIC_DRAW);
+            gl_state().bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_COPY);
+            gl_state().bindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(glm::mat4), NULL, GL_DYNAMIC_COPY);
+
+            std::vector<GLuint> drawIndices(capacity);
+            for (size_t i = 0; i < capacity; i++) drawIndices[i] = (GLuint)i;
+            gl_state().bindBuffer(GL_ARRAY_BUFFER, drawIndexBuffer);
+            glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GLuint), drawIndices.data(), GL_STATIC_DRAW);
+
+            MEMORY_TRACK_BUFFER(instanceBuffer, capacity * sizeof(CullInstance), MEMORY_BUFFER, "cull instances");
+            MEMORY_TRACK_BUFFER(commandBuffer, capacity * sizeof(DrawElementsIndirectCommand), MEMORY_BUFFER, "culled commands");
+            MEMORY_TRACK_BUFFER(drawDataBuffer, capacity * sizeof(glm::mat4), MEMORY_BUFFER, "culled draw data");
+            MEMORY_TRACK_BUFFER(drawIndexBuffer, capacity * sizeof(GLuint), MEMORY_VERTEX, "cull draw indices");
+        }
+        this->instances = instances;
+        if (instanceCount == 0) return;
+        gl_state().bindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, instanceCount * sizeof(CullInstance), instances.data());
+    }
+
+    // one changed instance (moved, other mesh) instead of the whole set
+    void setInstance(unsigned int index, const CullInstance& instance) {
+        if (index >= instanceCount) return;
+        instances[index] = instance;
+        gl_state().bindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, index * sizeof(CullInstance), sizeof(CullInstance), &instance);
+    }
+
+    // build this frame's commands; false while the program compiles
+    bool cull(const glm::mat4& viewProj) {
+        if (instanceCount == 0 || !cullProgram->ready()) return false;
+
+        // the counter restarts at 0, the command tail draws nothing
+        GLuint zero = 0;
+        gl_state().bindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        gl_state().bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glClearBufferSubData(GL_DRAW_INDIRECT_BUFFER, GL_R32UI, 0, instanceCount * sizeof(DrawElementsIndirectCommand),
+                             GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+        cullProgram->use();
+        glUniform1ui(glGetUniformLocation(cullProgram->ID, "instanceCount"), instanceCount);
+        glm::vec4 planes[6];
+        frustum_planes(viewProj, planes);
+        for (int p = 0; p < 6; p++)
+            cullProgram->setVec4("frustumPlanes[" + std::to_string(p) + "]", planes[p]);
+
+        cullProgram->setBool("occlusion", occlusion && hizValid);
+        if (hizValid) {
+            gl_state().bindTextureUnit(CULL_HIZ_TEXTURE_UNIT, GL_TEXTURE_2D, hizTexture);
+            cullProgram->setInt("hiz", CULL_HIZ_TEXTURE_UNIT);
+            cullProgram->setMat4("hizViewProj", hizViewProj);
+            cullProgram->setVec2("hizSize", (float)hizWidth, (float)hizHeight);
+            cullProgram->setInt("hizLevels", hizLevels);
+        }
+
+        bindStorage(CULL_INSTANCE_BINDING, instanceBuffer);
+        bindStorage(CULL_COMMAND_BINDING, commandBuffer);
+        bindStorage(CULL_MODEL_BINDING, drawDataBuffer);
+        bindStorage(CULL_COUNTER_BINDING, counterBuffer);
+        glDispatchCompute((instanceCount + 63) / 64, 1, 1);
+
+        // commands and count are read by the draw, the model matrices by the vertex shader
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+        return true;
+    }
+
+    // the commands of the last cull(); the shader in use reads models[aDrawIndex]
+    void draw(unsigned int VAO, GLenum indexType) {
+        if (instanceCount == 0) return;
+        gl_state().bindVertexArray(VAO);
+        gl_state().bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        // the compute pass wrote the models at CULL_MODEL_BINDING; the vertex shader reads them here
+        bindStorage(DRAW_DATA_BINDING, drawDataBuffer);
+        if (GLEW_ARB_indirect_parameters) {
+            gl_state().bindBuffer(GL_PARAMETER_BUFFER_ARB, counterBuffer);
+            glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, indexType, 0, 0, instanceCount, 0);
+        }
+        else glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, 0, instanceCount, 0);
+    }
+
+    // max-depth pyramid of the current window depth, used by the next cull()
+    void buildHiZ(const glm::mat4& viewProj, int width, int height) {
+        if (!hizProgram->ready() || width <= 0 || height <= 0) return;
+        if (width != hizWidth || height != hizHeight) createHiZ(width, height);
+
+        // from the bound read framebuffer: the window or the scaled scene target
+        gl_state().bindTextureUnit(CULL_HIZ_TEXTURE_UNIT, GL_TEXTURE_2D, depthTexture);
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+        hizProgram->use();
+        hizProgram->setInt("depth", CULL_HIZ_TEXTURE_UNIT);
+        int w = width, h = height;
+        for (int level = 0; level < hizLevels; level++) {
+            hizProgram->setInt("level", level);
+            glBindImageTexture(0, hizTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            if (level > 0) glBindImageTexture(1, hizTexture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+            glDispatchCompute((w + 7) / 8, (h + 7) / 8, 1);
+            // the next level reads this one
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        hizViewProj = viewProj;
+        hizValid = true;
+    }
+
+    // the pyramid no longer matches the scene (instances replaced, culling restarted)
+    void invalidateHiZ() {
+        hizValid = false;
+    }
+
+    // number of commands the last cull() wrote; reads back from the GPU, so not per frame
+    unsigned int visibleCount() {
+        GLuint count = 0;
+        gl_state().bindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &count);
+        return count;
+    }
+
+    // frustum-only cull of the current instance set, checked against the CPU; prints the
+    // result and returns false on any difference. The next cull() rewrites the commands.
+    bool verify(const glm::mat4& viewProj) {
+        if (instanceCount == 0 || !cullProgram->ready()) return true;
+        bool wasOcclusion = occlusion;
+        occlusion = false;
+        cull(viewProj);
+        occlusion = wasOcclusion;
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        unsigned int count = visibleCount();
+        std::vector<DrawElementsIndirectCommand> commands(instanceCount);
+        std::vector<glm::mat4> models(instanceCount);
+        gl_state().bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, instanceCount * sizeof(DrawElementsIndirectCommand), commands.data());
+        gl_state().bindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, instanceCount * sizeof(glm::mat4), models.data());
+
+        // the GPU survivors in slot order; each must be one instance, with its own mesh and model
+        unsigned int errors = 0;
+        if (count > instanceCount) {
+            errors++;
+            count = instanceCount;
+        }
+        std::vector<CullInstance> drawn;
+        for (unsigned int slot = 0; slot < count; slot++) {
+            const DrawElementsIndirectCommand& command = commands[slot];
+            if (command.instanceCount != 1 || command.baseInstance != slot) errors++;
+            CullInstance instance = cull_instance(MeshRange(), models[slot], glm::vec4(0.0f));
+            instance.count = command.count;
+            instance.firstIndex = command.firstIndex;
+            instance.baseVertex = command.baseVertex;
+            drawn.push_back(instance);
+        }
+        // the tail draws nothing
+        for (unsigned int slot = count; slot < instanceCount; slot++)
+            if (commands[slot].count != 0 || commands[slot].instanceCount != 0) errors++;
+
+        // the same test on the CPU; an instance within float rounding of a plane may go either way
+        glm::vec4 planes[6];
+        frustum_planes(viewProj, planes);
+        std::vector<CullInstance> required, optional;
+        for (unsigned int i = 0; i < instanceCount; i++) {
+            float margin = frustum_margin(instances[i], planes);
+            CullInstance key = instances[i];
+            key.sphere = glm::vec4(0.0f);
+            key.pad = 0;
+            if (fabsf(margin) <= 1e-4f * (1.0f + instances[i].sphere.w)) optional.push_back(key);
+            else if (margin > 0.0f) required.push_back(key);
+        }
+        std::sort(drawn.begin(), drawn.end(), instanceLess);
+        std::sort(required.begin(), required.end(), instanceLess);
+        std::sort(optional.begin(), optional.end(), instanceLess);
+
+        // drawn must hold every required instance, and nothing that is neither required nor optional
+        std::vector<CullInstance> missing, extra, unexpected;
+        std::set_difference(required.begin(), required.end(), drawn.begin(), drawn.end(), std::back_inserter(missing), instanceLess);
+        std::set_difference(drawn.begin(), drawn.end(), required.begin(), required.end(), std::back_inserter(extra), instanceLess);
+        std::set_difference(extra.begin(), extra.end(), optional.begin(), optional.end(), std::back_inserter(unexpected), instanceLess);
+        errors += (unsigned int)(missing.size() + unexpected.size());
+
+        std::cout << "CULLING: check " << (errors == 0 ? "passed" : "FAILED") << ", " << count << " of " << instanceCount
+                  << " instances drawn, " << required.size() << " expected, " << optional.size() << " on a plane";
+        if (errors > 0) std::cout << ", " << missing.size() << " missing, " << unexpected.size() << " unexpected";
+        std::cout << std::endl;
+        return errors == 0;
+    }
+
+    // smallest signed distance of the bounding sphere to a plane, outside the sphere;
+    // negative when the sphere is entirely outside one plane (cull_instances.comp culls it)
+    static float frustum_margin(const CullInstance& instance, const glm::vec4 planes[6]) {
+        const glm::mat4& m = instance.model;
+        glm::vec3 center = glm::vec3(m * glm::vec4(glm::vec3(instance.sphere), 1.0f));
+        float scale = std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+        float radius = instance.sphere.w * scale;
+        float margin = INFINITY;
+        for (int p = 0; p < 6; p++)
+            margin = std::min(margin, glm::dot(glm::vec3(planes[p]), center) + planes[p].w + radius);
+        return margin;
+    }
+
+    // world-space planes (a, b, c, d) with the inside at a*x + b*y + c*z + d >= 0
+    static void frustum_planes(const glm::mat4& m, glm::vec4 planes[6]) {
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        planes[0] = row3 + row0;
+        planes[1] = row3 - row0;
+        planes[2] = row3 + row1;
+        planes[3] = row3 - row1;
+        planes[4] = row3 + row2;
+        planes[5] = row3 - row2;
+        for (int p = 0; p < 6; p++) planes[p] /= glm::length(glm::vec3(planes[p]));
+    }
+
+private:
+    size_t capacity = 0;
+    std::vector<CullInstance> instances;    // CPU copy for verify()
+
+    // byte order of model and mesh; sphere and pad are zero in the compared copies
+    static bool instanceLess(const CullInstance& a, const CullInstance& b) {
+        return memcmp(&a, &b, sizeof(CullInstance)) < 0;
+    }
+
+    void bindStorage(GLuint binding, unsigned int buffer) {
+        gl_state().bindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+    }
+
+    void createHiZ(int width, int height) {
+        releaseHiZ();
+        hizWidth = width;
+        hizHeight = height;
+        hizLevels = 1;
+        for (int size = width > height ? width : height; size > 1; size /= 2) hizLevels++;
+
+        glGenTextures(1, &depthTexture);
+        gl_state().bindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, width, height);
+        MEMORY_TRACK_TEXTURE(depthTexture, texture_bytes(GL_DEPTH_COMPONENT24, width, height), MEMORY_RENDER_TARGET, "culling depth");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenTextures(1, &hizTexture);
+        gl_state().bindTexture(GL_TEXTURE_2D, hizTexture);
+        glTexStorage2D(GL_TEXTURE_2D, hizLevels, GL_R32F, width, height);
+        MEMORY_TRACK_TEXTURE(hizTexture, texture_bytes(GL_R32F, width, height, 1, hizLevels), MEMORY_RENDER_TARGET, "hi-z pyramid");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        hizValid = false;
+    }
+
+    void releaseHiZ() {
+        if (depthTexture != 0) gl_state().deleteTextures(1, &depthTexture);
+        if (hizTexture != 0) gl_state().deleteTextures(1, &hizTexture);
+        depthTexture = hizTexture = 0;
+    }
+
+    GpuCuller(const GpuCuller&);
+    GpuCuller& operator=(const GpuCuller&);
+};
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef GPU_PARTICLES_H
+#define GPU_PARTICLES_H
+
+// Particles that live entirely on the GPU.
+//      ShaderProgram* update = shaders.submitFeedback("particle_update.vs", GpuParticles::feedbackVaryings());
+//      ShaderProgram* look = shaders.submit("particle.vs", "particle.fs");
+//      GpuParticles particles(update, look, quadVBO);
+//      particles.resize(1 << 20);
+//      ...
+//      particles.update(dt, time);     // transform feedback: buffer[current] -> buffer[1 - current]
+//      particles.draw();               // one instanced draw of the quad per particle
+//
+// A particle is two vec4 (orbit: angle, angular speed, spiral phase, spiral rate;
+// state: age, life, size, seed). The update program runs one vertex per particle with
+// GL_RASTERIZER_DISCARD and writes the advanced particle into the other buffer; a
+// particle past its life respawns in place from a hash of its index, the time and its
+// old seed, so the pool stays dense and needs no compaction or CPU emitter.
+// Per frame the CPU issues the same handful of calls whatever the particle count.
+// Both programs come from ShaderManager; update() and draw() do nothing until they
+// are ready.
+//
+// Transform feedback is core in GL 3.3; no compute shader or extension is needed.
+// resize() clears the new pool on the GPU: glClearBufferData where ARB_clear_buffer_object
+// exists, otherwise one small zero block doubled in place with glCopyBufferSubData.
+// Nothing of the pool's size is ever built on the CPU.
+
+#include <GL/glew.h>
+#include <gl_state.h>
+#include <shader_manager.h>
+#include <vector>
+#include <string>
+
+struct Particle {
+    float orbit[4];
+    float state[4];
+};
+
+#define GPU_PARTICLES_MAX (1u << 22)            // 128 MB per buffer, two buffers
+#define GPU_PARTICLES_ZERO_BLOCK 4096           // particles uploaded by the GL 3.3 clear
+
+class GpuParticles {
+public:
+    unsigned int count = 0;
+    ShaderProgram* updateShader;            // particle_update.vs, linked with feedbackVaryings()
+    ShaderProgram* drawShader;
+    unsigned int buffers[2] = { 0, 0 };
+    unsigned int updateVAO[2] = { 0, 0 };   // reads buffers[i] as vertices
+    unsigned int drawVAO[2] = { 0, 0 };     // the quad + buffers[i] as instances
+    int current = 0;                        // buffer holding the latest particles
+
+    // the outputs of the update program, in Particle order
+    static std::vector<std::string> feedbackVaryings() {
+        std::vector<std::string> varyings;
+        varyings.push_back("outOrbit");
+        varyings.push_back("outState");
+        return varyings;
+    }
+
+    // quadVBO: 4 vertices of vec2/vec3 at attribute 0, drawn as a triangle fan
+    GpuParticles(ShaderProgram* updateShader, ShaderProgram* drawShader,
+                 unsigned int quadVBO, GLint quadComponents = 2) {
+        this->updateShader = updateShader;
+        this->drawShader = drawShader;
+
+        glGenBuffers(2, buffers);
+        glGenVertexArrays(2, updateVAO);
+        glGenVertexArrays(2, drawVAO);
+        for (int i = 0; i < 2; i++) {
+            gl_state().bindVertexArray(updateVAO[i]);
+            gl_state().bindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+            particleAttributes(0, 0);
+
+            gl_state().bindVertexArray(drawVAO[i]);
+            gl_state().bindBuffer(GL_ARRAY_BUFFER, quadVBO);
+            glVertexAttribPointer(0, quadComponents, GL_FLOAT, GL_FALSE, quadComponents * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            gl_state().bindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+            particleAttributes(1, 1);
+        }
+    }
+
+    ~GpuParticles() {
+        gl_state().deleteVertexArrays(2, updateVAO);
+        gl_state().deleteVertexArrays(2, drawVAO);
+        gl_state().deleteBuffers(2, buffers);
+    }
+
+    // new pool of `count` particles, at most GPU_PARTICLES_MAX; all spawn in the next update()
+    void resize(unsigned int count) {
+        if (count > GPU_PARTICLES_MAX) count = GPU_PARTICLES_MAX;
+        this->count = count;
+        for (int i = 0; i < 2; i++) {
+            gl_state().bindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+            glBufferData(GL_ARRAY_BUFFER, count * sizeof(Particle), NULL, GL_DYNAMIC_COPY);
+            MEMORY_TRACK_BUFFER(buffers[i], count * sizeof(Particle), MEMORY_VERTEX, "particles");
+        }
+        clear(buffers[current]);
+    }
+
+    void update(float dt, float time) {
+        if (count == 0 || !updateShader->ready()) return;
+        int next = 1 - current;
+
+        updateShader->use();
+        updateShader->setFloat("dt", dt);
+        updateShader->setFloat("time", time);
+        gl_state().bindVertexArray(updateVAO[current]);
+        gl_state().bindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[next]);
+
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, count);
+        glEndTransformFeedback();
+        glDisable(GL_RASTERIZER_DISCARD);
+        gl_state().bindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+
+        current = next;
+    }
+
+    // blended over what is already drawn
+    void draw() {
+        if (count == 0 || !drawShader->ready()) return;
+        drawShader->use();
+        gl_state().bindVertexArray(drawVAO[current]);
+        gl_state().enable(GL_BLEND);
+        gl_state().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, count);
+        gl_state().disable(GL_BLEND);
+    }
+
+private:
+    // every particle zero, so life 0: never spawned. The other buffer is written by update()
+    void clear(unsigned int buffer) {
+        if (count == 0) return;
+        gl_state().bindBuffer(GL_ARRAY_BUFFER, buffer);
+        if (GLEW_ARB_clear_buffer_object) {
+            float zero = 0.0f;
+            glClearBufferData(GL_ARRAY_BUFFER, GL_R32F, GL_RED, GL_FLOAT, &zero);
+            return;
+        }
+        size_t bytes = (size_t)count * sizeof(Particle);
+        size_t filled = (count < GPU_PARTICLES_ZERO_BLOCK ? count : GPU_PARTICLES_ZERO_BLOCK) * sizeof(Particle);
+        std::vector<Particle> zero(filled / sizeof(Particle), Particle());
+        glBufferSubData(GL_ARRAY_BUFFER, 0, filled, zero.data());
+        // copy the cleared front over the rest, doubling it each time
+        gl_state().bindBuffer(GL_COPY_READ_BUFFER, buffer);
+        gl_state().bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        while (filled < bytes) {
+            size_t copied = filled < bytes - filled ? filled : bytes - filled;
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, filled, copied);
+            filled += copied;
+        }
+    }
+
+    // orbit at `location`, state at location + 1
+    void particleAttributes(GLuint location, GLuint divisor) {
+        for (GLuint i = 0; i < 2; i++) {
+            glVertexAttribPointer(location + i, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)(i * 4 * sizeof(float)));
+            glEnableVertexAttribArray(location + i);
+            glVertexAttribDivisor(location + i, divisor);
+        }
+    }
+
+    GpuParticles(const GpuParticles&);
+    GpuParticles& operator=(const GpuParticles&);
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef HEXPRISM_H
+#define HEXPRISM_H
+
+// Hexagonal prism geometry shared by HW07 and HW08.
+// Each of the 6 side faces is a quad of 4 vertices (24 vertices in total),
+// drawn with 36 indices as two triangles per face.
+// HexPrism::tables holds the same arrays built at compile time; the runtime
+// generator below is the reference they are checked against.
+// hex_prism_mesh() is what HW07 and HW08 draw: the tables run through meshopt.h.
+
+#include <GL/glew.h>
+#include <primitives.h>
+#include <meshopt.h>
+#include <vector>
+#define _USE_MATH_DEFINES
+#include <cmath>
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+// The prism as the HW07 / HW08 shaders read it: position, normal and texture coordinate
+// interleaved (HEX_MESH_STRIDE floats; neither program reads the colors), welded,
+// reordered for the vertex cache and for fetch locality, with 16 bit indices.
+// The per-corner colors kept every corner apart; without them neighbouring faces share
+// their edge vertices and only the u = 0 / u = 1 seam stays split.
+struct HexPrismMesh {
+    std::vector<GLfloat> vertices;
+    IndexData indices;
+    unsigned int vertexCount = 0;
+    float acmrBefore = 0.0f, acmrAfter = 0.0f;
+};
+
+inline HexPrismMesh hex_prism_mesh() {
+    const PrismTables<6>& t = HexPrism::tables;
+    HexPrismMesh mesh;
+    mesh.vertices.resize(HexPrism::vertexCount * HEX_MESH_STRIDE);
+    for (int v = 0; v < HexPrism::vertexCount; v++) {
+        GLfloat* out = &mesh.vertices[v * HEX_MESH_STRIDE];
+        for (int k = 0; k < 3; k++) out[k] = t.vertices[v * 3 + k];
+        for (int k = 0; k < 3; k++) out[3 + k] = t.normals[v * 3 + k];
+        for (int k = 0; k < 2; k++) out[6 + k] = t.texCoords[v * 2 + k];
+    }
+    std::vector<unsigned int> indices(t.indices, t.indices + HexPrism::indexCount);
+
+    mesh.acmrBefore = average_cache_miss_ratio(indices, HexPrism::vertexCount);
+    size_t welded = weld_vertices(mesh.vertices, HEX_MESH_STRIDE, indices);
+    optimize_vertex_cache(indices, welded);
+    optimize_vertex_fetch(mesh.vertices, HEX_MESH_STRIDE, indices);
+    mesh.vertexCount = (unsigned int)(mesh.vertices.size() / HEX_MESH_STRIDE);
+    mesh.acmrAfter = average_cache_miss_ratio(indices, mesh.vertexCount);
+    mesh.indices = pack_indices(indices, mesh.vertexCount);
+    return mesh;
+}
+
+#endif
+
+#define HEX_VERTEX_FLOATS   72  // 24 vertices * vec3
+#define HEX_NORMAL_FLOATS   72  // 24 vertices * vec3
+#define HEX_COLOR_FLOATS    96  // 24 vertices * vec4
+#define HEX_TEXCOORD_FLOATS 48  // 24 vertices * vec2
+#define HEX_INDEX_COUNT     36
+#define HEX_MESH_STRIDE     8   // interleaved floats per vertex of hex_prism_mesh()
+
+typedef Prism<6> HexPrism;
+static_assert(sizeof(HexPrism::tables.vertices) == HEX_VERTEX_FLOATS * sizeof(GLfloat), "prism table size");
+static_assert(sizeof(HexPrism::tables.normals) == HEX_NORMAL_FLOATS * sizeof(GLfloat), "prism table size");
+static_assert(sizeof(HexPrism::tables.colors) == HEX_COLOR_FLOATS * sizeof(GLfloat), "prism table size");
+static_assert(sizeof(HexPrism::tables.texCoords) == HEX_TEXCOORD_FLOATS * sizeof(GLfloat), "prism table size");
+static_assert(HexPrism::indexCount == HEX_INDEX_COUNT, "prism table size");
+
+// fill the vertex, normal, color and texture coordinate arrays of the prism
+inline void hex_prism_vertice_mapping(GLfloat* vertices, GLfloat* normals, GLfloat* colors, GLfloat* texCoords) {
+    for (int i = 0; i < 6; i++) {
+        vertices[i * 12] = sin(i * M_PI / 3);
+        vertices[i * 12 + 1] = -1; // y = -1
+        vertices[i * 12 + 2] = cos(i * M_PI / 3);
+        vertices[i * 12 + 3] = sin(i * M_PI / 3);
+        vertices[i * 12 + 4] = 1; // y = 1
+        vertices[i * 12 + 5] = cos(i * M_PI / 3);
+        vertices[i * 12 + 6] = sin((i + 1) * M_PI / 3);
+        vertices[i * 12 + 7] = 1;
+        vertices[i * 12 + 8] = cos((i + 1) * M_PI / 3);
+        vertices[i * 12 + 9] = sin((i + 1) * M_PI / 3);
+        vertices[i * 12 + 10] = -1;
+        vertices[i * 12 + 11] = cos((i + 1) * M_PI / 3);
+    }
+
+    for (int i = 0; i < 6; i++) {
+        normals[i * 12] = 0;
+        normals[i * 12 + 1] = 0;
+        normals[i * 12 + 2] = -1;
+        normals[i * 12 + 3] = 0;
+        normals[i * 12 + 4] = 0;
+        normals[i * 12 + 5] = 1;
+        normals[i * 12 + 6] = 0;
+        normals[i * 12 + 7] = 0;
+        normals[i * 12 + 8] = 1;
+        normals[i * 12 + 9] = 0;
+        normals[i * 12 + 10] = 0;
+        normals[i * 12 + 11] = -1;
+    }
+
+    for (int i = 0; i < 6; i++) {
+        colors[i * 16] = 1;
+        colors[i * 16 + 1] = 0;
+        colors[i * 16 + 2] = 0;
+        colors[i * 16 + 3] = 1;
+        colors[i * 16 + 4] = 1;
+        colors[i * 16 + 5] = 0;
+        colors[i * 16 + 6] = 0;
+        colors[i * 16 + 7] = 1;
+        colors[i * 16 + 8] = 0;
+        colors[i * 16 + 9] = 1;
+        colors[i * 16 + 10] = 0;
+        colors[i * 16 + 11] = 1;
+        colors[i * 16 + 12] = 0;
+        colors[i * 16 + 13] = 0;
+        colors[i * 16 + 14] = 1;
+        colors[i * 16 + 15] = 1;
+    }
+
+    for (int i = 0; i < 6; i++) {
+        texCoords[i * 8] = i / 6.;
+        texCoords[i * 8 + 1] = 1.;
+        texCoords[i * 8 + 2] = i / 6.;
+        texCoords[i * 8 + 3] = 0.;
+        texCoords[i * 8 + 4] = (i + 1) / 6.;
+        texCoords[i * 8 + 5] = 0.;
+        texCoords[i * 8 + 6] = (i + 1) / 6.;
+        texCoords[i * 8 + 7] = 1.;
+    }
+}
+
+// The prism as the HW07 / HW08 shaders read it: position, normal and texture coordinate
+// interleaved (HEX_MESH_STRIDE floats; neither program reads the colors), welded,
+// reordered for the vertex cache and for fetch locality, with 16 bit indices.
+// The per-corner colors kept every corner apart; without them neighbouring faces share
+// their edge vertices and only the u = 0 / u = 1 seam stays split.
+struct HexPrismMesh {
+    std::vector<GLfloat> vertices;
+    IndexData indices;
+    unsigned int vertexCount = 0;
+    float acmrBefore = 0.0f, acmrAfter = 0.0f;
+};
+
+inline HexPrismMesh hex_prism_mesh() {
+    const PrismTables<6>& t = HexPrism::tables;
+    HexPrismMesh mesh;
+    mesh.vertices.resize(HexPrism::vertexCount * HEX_MESH_STRIDE);
+    for (int v = 0; v < HexPrism::vertexCount; v++) {
+        GLfloat* out = &mesh.vertices[v * HEX_MESH_STRIDE];
+        for (int k = 0; k < 3; k++) out[k] = t.vertices[v * 3 + k];
+        for (int k = 0; k < 3; k++) out[3 + k] = t.normals[v * 3 + k];
+        for (int k = 0; k < 2; k++) out[6 + k] = t.texCoords[v * 2 + k];
+    }
+    std::vector<unsigned int> indices(t.indices, t.indices + HexPrism::indexCount);
+
+    mesh.acmrBefore = average_cache_miss_ratio(indices, HexPrism::vertexCount);
+    size_t welded = weld_vertices(mesh.vertices, HEX_MESH_STRIDE, indices);
+    optimize_vertex_cache(indices, welded);
+    optimize_vertex_fetch(mesh.vertices, HEX_MESH_STRIDE, indices);
+    mesh.vertexCount = (unsigned int)(mesh.vertices.size() / HEX_MESH_STRIDE);
+    mesh.acmrAfter = average_cache_miss_ratio(indices, mesh.vertexCount);
+    mesh.indices = pack_indices(indices, mesh.vertexCount);
+    return mesh;
+}
+
+#endif
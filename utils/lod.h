@@ -0,0 +1,128 @@
+#ifndef LOD_H
+#define LOD_H
+
+// Screen-space level of detail for tessellated primitives.
+//      LodChain chain;                               // finest level first
+//      for (...) chain.addLevel(cylinder_lod_error(1.0f, segments), triangles);
+//      LodState state;                               // one per instance
+//      int level = chain.select(state, distance, dt); // state.previous / state.fade during a cross-fade
+//
+// Each level stores its object-space geometric error (largest distance between the
+// tessellation and the true surface). select() projects it to pixels and keeps the
+// coarsest level below pixelError; coarsening needs the error to be hysteresis times
+// lower again, so an instance sitting at a threshold does not flip every frame.
+// With crossfade the old level keeps drawing while the new one dithers in
+// (shaders discard with the complementary patterns of lod_fade_uniforms()). The
+// shader side is one file, HW09's lod_dither.glsl, #included by every pass that draws
+// a level; the passes must discard the same pixels or GL_EQUAL shading misses.
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cmath>
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// chord error of an n-gon approximating a circle: cylinders and cylinder-like prisms
+inline float cylinder_lod_error(float radius, int segments) {
+    return radius * (1.0f - cosf((float)M_PI / segments));
+}
+
+// UV sphere: the larger of the slice and stack chord errors
+inline float sphere_lod_error(float radius, int slices, int stacks) {
+    float slice = cylinder_lod_error(radius, slices);
+    float stack = cylinder_lod_error(radius, stacks * 2);
+    return slice > stack ? slice : stack;
+}
+
+// a prism is its own exact tessellation: every level has zero error
+inline float prism_lod_error() {
+    return 0.0f;
+}
+
+// segment counts of a chain: finest, finest / 2, ... down to coarsest
+inline std::vector<int> lod_segment_chain(int finest, int coarsest) {
+    std::vector<int> segments;
+    for (int n = finest; n >= coarsest; n /= 2) segments.push_back(n);
+    return segments;
+}
+
+struct LodState {
+    int level = 0;
+    int previous = -1;              // level fading out, -1 when no cross-fade is running
+    float fade = 1.0f;              // 0..1 progress of the cross-fade
+};
+
+// lodFade uniform of the incoming (current) and the outgoing (previous) level
+inline void lod_fade_uniforms(const LodState& state, float& incoming, float& outgoing) {
+    if (state.previous < 0) {
+        incoming = outgoing = 0.0f;     // no dithering
+        return;
+    }
+    float t = glm::clamp(state.fade, 1.0f / 64.0f, 63.0f / 64.0f);
+    incoming = t;
+    outgoing = -t;
+}
+
+class LodChain {
+public:
+    std::vector<float> errors;              // object space, finest level first
+    std::vector<unsigned int> triangles;
+
+    // selection parameters
+    float pixelError = 1.0f;                // allowed projected error
+    float hysteresis = 0.5f;                // coarsen only below pixelError * hysteresis
+    bool crossfade = true;
+    float fadeTime = 0.3f;                  // seconds
+
+    // projection: vertical field of view and viewport height
+    float fovy = glm::radians(45.0f);
+    int screenHeight = 600;
+
+    void addLevel(float error, unsigned int triangleCount) {
+        errors.push_back(error);
+        triangles.push_back(triangleCount);
+    }
+
+    int levels() const {
+        return (int)errors.size();
+    }
+
+    // pixels covered by an object-space length at a view distance
+    float projectedPixels(float length, float distance) const {
+        if (distance <= 0.0f) return 1e30f;
+        return length * screenHeight / (2.0f * tanf(fovy * 0.5f) * distance);
+    }
+
+    // update an instance's level (scaled by the instance's world scale) and its cross-fade
+    int select(LodState& state, float distance, float dt, float scale = 1.0f) {
+        if (state.previous >= 0) {
+            state.fade += fadeTime > 0.0f ? dt / fadeTime : 1.0f;
+            if (state.fade >= 1.0f) {
+                state.previous = -1;
+                state.fade = 1.0f;
+            }
+        }
+
+        int level = state.level;
+        if (projectedPixels(errors[level] * scale, distance) > pixelError) {
+            // too coarse: the coarsest finer level that is good enough
+            while (level > 0 && projectedPixels(errors[level] * scale, distance) > pixelError) level--;
+        }
+        else {
+            // coarser only with a margin
+            while (level + 1 < levels() && projectedPixels(errors[level + 1] * scale, distance) <= pixelError * hysteresis)
+                level++;
+        }
+
+        if (level != state.level) {
+            // a switch during a fade restarts it from the level on screen now
+            state.previous = crossfade ? state.level : -1;
+            state.fade = crossfade ? 0.0f : 1.0f;
+            state.level = level;
+        }
+        return level;
+    }
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef MATERIAL_POOL_H
+#define MATERIAL_POOL_H
+
+// Material texture pool: every material map is one layer of a single
+// GL_TEXTURE_2D_ARRAY. The array is bound once; a draw only sets the layer
+// indices of its material, so any number of materials render without texture binds.
+//      MaterialTexturePool pool(512);
+//      Material m = { pool.add("a.bmp"), pool.add("a_specular.bmp"), 32.0f };
+//      pool.build();  pool.bind(0);           // once
+//      set_material(shader, m);                 // per draw
+//
+// Maps of another size are resampled (bilinear) to the pool size when they are added.
+// The STB_IMAGE_IMPLEMENTATION lives in the program's main.cpp.
+
+#include <GL/glew.h>
+#include <stb_image.h>
+#include <shader_manager.h>
+#include <gl_state.h>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <string>
+#include <iostream>
+#include <cmath>
+
+// layer indices of a material's maps (-1: none)
+struct Material {
+    int diffuseLayer;
+    int specularLayer;
+    float shininess;
+};
+
+// per draw: no texture bind, only the layer uniforms
+inline void set_material(ShaderProgram* shader, const Material& material) {
+    shader->setInt("material.diffuseLayer", material.diffuseLayer);
+    shader->setInt("material.specularLayer", material.specularLayer);
+    shader->setFloat("material.shininess", material.shininess);
+}
+
+class MaterialTexturePool {
+public:
+    unsigned int texture = 0;
+    int size;                       // width and height of every layer
+    int layers = 0;
+
+    MaterialTexturePool(int size = 512) {
+        this->size = size;
+    }
+
+    ~MaterialTexturePool() {
+        if (texture != 0) gl_state().deleteTextures(1, &texture);
+    }
+
+    // load an image into the next layer (uploaded by build()); returns the layer or -1
+    int add(const char* path) {
+        int width, height, channels;
+        stbi_set_flip_vertically_on_load(true);   // vertical flip the texture
+        unsigned char* image = stbi_load(path, &width, &height, &channels, 4);
+        if (!image) {
+            std::cout << "MATERIAL: " << path << " loading error" << std::endl;
+            return -1;
+        }
+
+        std::vector<unsigned char> pixels((size_t)size * size * 4);
+        if (width == size && height == size) {
+            std::copy(image, image + pixels.size(), pixels.begin());
+        }
+        else {
+            resample(image, width, height, pixels.data());
+            std::cout << "MATERIAL: " << path << " " << width << "x" << height << " resampled to "
+                      << size << "x" << size << std::endl;
+        }
+        stbi_image_free(image);
+
+        staged.push_back(std::move(pixels));
+        return layers++;
+    }
+
+    // upload every added layer into one array texture with mipmaps; call once after the add()s
+    void build() {
+        if (texture != 0) gl_state().deleteTextures(1, &texture);
+        glGenTextures(1, &texture);
+        gl_state().bindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        for (int layer = 0; layer < layers; layer++)
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, staged[layer].data());
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        MEMORY_TRACK_TEXTURE(texture, texture_bytes(GL_RGBA8, size, size, layers, mip_levels(size, size)), MEMORY_TEXTURE, "material array");
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        // the pixels live on the GPU now
+        staged.clear();
+        staged.shrink_to_fit();
+        std::cout << "MATERIAL: " << layers << " layers of " << size << "x" << size << " in one texture array" << std::endl;
+    }
+
+    void bind(int unit) {
+        gl_state().bindTextureUnit(unit, GL_TEXTURE_2D_ARRAY, texture);
+    }
+
+private:
+    std::vector<std::vector<unsigned char>> staged;
+
+    void resample(const unsigned char* src, int width, int height, unsigned char* dst) {
+        for (int y = 0; y < size; y++) {
+            float fy = (y + 0.5f) * height / size - 0.5f;
+            int y0 = fy < 0.0f ? 0 : (int)fy;
+            int y1 = y0 + 1 < height ? y0 + 1 : height - 1;
+            float ty = fy < 0.0f ? 0.0f : fy - y0;
+            for (int x = 0; x < size; x++) {
+                float fx = (x + 0.5f) * width / size - 0.5f;
+                int x0 = fx < 0.0f ? 0 : (int)fx;
+                int x1 = x0 + 1 < width ? x0 + 1 : width - 1;
+                float tx = fx < 0.0f ? 0.0f : fx - x0;
+                for (int c = 0; c < 4; c++) {
+                    float top = src[(y0 * width + x0) * 4 + c] * (1.0f - tx) + src[(y0 * width + x1) * 4 + c] * tx;
+                    float bottom = src[(y1 * width + x0) * 4 + c] * (1.0f - tx) + src[(y1 * width + x1) * 4 + c] * tx;
+                    dst[(y * size + x) * 4 + c] = (unsigned char)(top * (1.0f - ty) + bottom * ty + 0.5f);
+                }
+            }
+        }
+    }
+
+    MaterialTexturePool(const MaterialTexturePool&);
+    MaterialTexturePool& operator=(const MaterialTexturePool&);
+};
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+// Byte accounting for GL storage and large CPU blocks.
+//      glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_STATIC_DRAW);
+//      MEMORY_TRACK_BUFFER(VBO, bytes, MEMORY_VERTEX, "mesh vertices");
+//      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, ...);
+//      MEMORY_TRACK_TEXTURE(texture, texture_bytes(GL_RGBA8, w, h), MEMORY_TEXTURE, "container");
+//      ...
+//      memory_tracker().report();          // live / peak bytes per category
+//      memory_tracker().reportLeaks();     // at shutdown: everything never released
+//
+// Every record keeps its byte count, category, tag and the file:line that made it.
+// Tracking the same name again (a glBufferData that reallocates) replaces its record.
+// Deleting a buffer, texture or renderbuffer through gl_state() releases its record,
+// so what reportLeaks() lists is storage nothing deleted: an object whose destructor
+// never ran, or a name that was overwritten by a new glGen* without a delete.
+//
+// Byte counts are what the code asked for; the driver's padding and mip alignment
+// are not visible from here.
+//
+// MEMORY_TRACKING 0 compiles the macros to nothing.
+
+#include <GL/glew.h>
+#include <unordered_map>
+#include <mutex>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+
+#ifndef MEMORY_TRACKING
+#define MEMORY_TRACKING 1
+#endif
+
+enum MemoryCategory {
+    MEMORY_VERTEX = 0,              // vertex buffers
+    MEMORY_INDEX = 1,               // element buffers
+    MEMORY_BUFFER = 2,              // uniform, storage, indirect, transfer buffers
+    MEMORY_TEXTURE = 3,             // sampled textures
+    MEMORY_RENDER_TARGET = 4,       // framebuffer attachments
+    MEMORY_CPU = 5,                 // system memory blocks
+    MEMORY_CATEGORIES = 6
+};
+
+enum MemoryObject {
+    MEMORY_GL_BUFFER = 0,
+    MEMORY_GL_TEXTURE = 1,
+    MEMORY_GL_RENDERBUFFER = 2,
+    MEMORY_HOST = 3,                // keyed by address
+    MEMORY_OBJECTS = 4
+};
+
+// bytes per texel of the internal formats used in this repo; 4 for anything else
+inline size_t texel_bytes(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_R8: case GL_RED: return 1;
+    case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+    case GL_RGB8: case GL_RGB: case GL_DEPTH_COMPONENT24: return 3;
+    case GL_RGBA16F: case GL_RGBA16UI: case GL_RG32F: return 8;
+    case GL_RGB16F: return 6;
+    case GL_RGBA32F: return 16;
+    case GL_RGB32F: return 12;
+    }
+    return 4;
+}
+
+// `levels` mip levels of a width x height x layers image, each level half the last
+inline size_t texture_bytes(GLenum internalFormat, size_t width, size_t height, size_t layers = 1, int levels = 1) {
+    size_t total = 0;
+    for (int l = 0; l < levels; l++) {
+        total += width * height;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return total * layers * texel_bytes(internalFormat);
+}
+
+// levels of a full chain down to 1x1, for glGenerateMipmap
+inline int mip_levels(size_t width, size_t height) {
+    int levels = 1;
+    while (width > 1 || height > 1) {
+        width /= 2;
+        height /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+inline MemoryCategory buffer_category(GLenum target) {
+    if (target == GL_ARRAY_BUFFER) return MEMORY_VERTEX;
+    if (target == GL_ELEMENT_ARRAY_BUFFER) return MEMORY_INDEX;
+    return MEMORY_BUFFER;
+}
+
+class MemoryTracker {
+public:
+    struct Record {
+        size_t bytes;
+        MemoryCategory category;
+        const char* tag;            // string literals only: the pointer is kept
+        const char* file;
+        int line;
+    };
+
+    // per category
+    size_t live[MEMORY_CATEGORIES] = {};
+    size_t peak[MEMORY_CATEGORIES] = {};
+    unsigned int objects[MEMORY_CATEGORIES] = {};
+
+    void track(MemoryObject kind, uintptr_t id, size_t bytes, MemoryCategory category,
+               const char* tag, const char* file, int line) {
+        if (id == 0) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unordered_map<uintptr_t, Record>::iterator it = records[kind].find(id);
+        if (it != records[kind].end()) forget(it->second);
+        else it = records[kind].insert(std::make_pair(id, Record())).first;
+
+        Record& record = it->second;
+        record.bytes = bytes;
+        record.category = category;
+        record.tag = tag;
+        record.file = file;
+        record.line = line;
+        live[category] += bytes;
+        objects[category]++;
+        if (live[category] > peak[category]) peak[category] = live[category];
+    }
+
+    void release(MemoryObject kind, uintptr_t id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unordered_map<uintptr_t, Record>::iterator it = records[kind].find(id);
+        if (it == records[kind].end()) return;
+        forget(it->second);
+        records[kind].erase(it);
+    }
+
+    void release(MemoryObject kind, GLsizei n, const GLuint* ids) {
+        for (GLsizei i = 0; i < n; i++) release(kind, ids[i]);
+    }
+
+    size_t total() const {
+        size_t sum = 0;
+        for (int c = 0; c < MEMORY_CATEGORIES; c++) sum += live[c];
+        return sum;
+    }
+
+    size_t gpuTotal() const {
+        return total() - live[MEMORY_CPU];
+    }
+
+    void report() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int c = 0; c < MEMORY_CATEGORIES; c++) {
+            if (peak[c] == 0) continue;
+            std::cout << "MEMORY: " << categoryName(c) << " " << kilobytes(live[c]) << " KB in " << objects[c]
+                      << " objects, peak " << kilobytes(peak[c]) << " KB" << std::endl;
+        }
+    }
+
+    // lists every record still alive; returns how many
+    size_t reportLeaks() {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t leaks = 0, bytes = 0;
+        for (int kind = 0; kind < MEMORY_OBJECTS; kind++) {
+            for (std::unordered_map<uintptr_t, Record>::const_iterator it = records[kind].begin(); it != records[kind].end(); ++it) {
+                const Record& record = it->second;
+                std::cout << "MEMORY: leaked " << record.bytes << " bytes of " << categoryName(record.category)
+                          << " \"" << record.tag << "\" from " << baseName(record.file) << ":" << record.line << std::endl;
+                leaks++;
+                bytes += record.bytes;
+            }
+        }
+        if (leaks == 0) std::cout << "MEMORY: no leaks" << std::endl;
+        else std::cout << "MEMORY: " << leaks << " allocations, " << kilobytes(bytes) << " KB never released" << std::endl;
+        return leaks;
+    }
+
+private:
+    std::unordered_map<uintptr_t, Record> records[MEMORY_OBJECTS];
+    std::mutex mutex;
+
+    void forget(const Record& record) {
+        live[record.category] -= record.bytes;
+        objects[record.category]--;
+    }
+
+    static const char* categoryName(int category) {
+        static const char* names[MEMORY_CATEGORIES] = { "vertex", "index", "buffer", "texture", "render target", "cpu" };
+        return names[category];
+    }
+
+    static size_t kilobytes(size_t bytes) {
+        return (bytes + 1023) / 1024;
+    }
+
+    // __FILE__ is a full path under MSVC
+    static const char* baseName(const char* path) {
+        const char* slash = strrchr(path, '/');
+        const char* backslash = strrchr(path, '\\');
+        if (backslash != NULL && (slash == NULL || backslash > slash)) slash = backslash;
+        return slash != NULL ? slash + 1 : path;
+    }
+};
+
+inline MemoryTracker& memory_tracker() {
+    static MemoryTracker tracker;
+    return tracker;
+}
+
+#if MEMORY_TRACKING
+#define MEMORY_TRACK_BUFFER(name, bytes, category, tag) \
+    memory_tracker().track(MEMORY_GL_BUFFER, (name), (bytes), (category), (tag), __FILE__, __LINE__)
+#define MEMORY_TRACK_TEXTURE(name, bytes, category, tag) \
+    memory_tracker().track(MEMORY_GL_TEXTURE, (name), (bytes), (category), (tag), __FILE__, __LINE__)
+#define MEMORY_TRACK_RENDERBUFFER(name, bytes, tag) \
+    memory_tracker().track(MEMORY_GL_RENDERBUFFER, (name), (bytes), MEMORY_RENDER_TARGET, (tag), __FILE__, __LINE__)
+#define MEMORY_TRACK_HOST(pointer, bytes, tag) \
+    memory_tracker().track(MEMORY_HOST, (uintptr_t)(pointer), (bytes), MEMORY_CPU, (tag), __FILE__, __LINE__)
+#define MEMORY_RELEASE_HOST(pointer) memory_tracker().release(MEMORY_HOST, (uintptr_t)(pointer))
+#else
+#define MEMORY_TRACK_BUFFER(name, bytes, category, tag) ((void)0)
+#define MEMORY_TRACK_TEXTURE(name, bytes, category, tag) ((void)0)
+#define MEMORY_TRACK_RENDERBUFFER(name, bytes, tag) ((void)0)
+#define MEMORY_TRACK_HOST(pointer, bytes, tag) ((void)0)
+#define MEMORY_RELEASE_HOST(pointer) ((void)0)
+#endif
+
+#endif
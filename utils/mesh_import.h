@@ -0,0 +1,491 @@
+#ifndef MESH_IMPORT_H
+#define MESH_IMPORT_H
+
+// Wavefront OBJ import with a binary cache.
+//      MeshAsset mesh;
+//      if (mesh.load("hw10.obj")) ... mesh.VAO, mesh.indexCount, mesh.indexType
+//
+// The first load parses the OBJ in parallel: the file is cut into one chunk per
+// hardware thread at line boundaries, every chunk parses its v/vt/vn/f lines on its
+// own thread, and after a prefix sum over the chunk counts the faces are expanded into
+// MeshFormat vertices, again one thread per chunk. The mesh is then welded and
+// reordered like the generated meshes (meshopt.h) and written to "<path>.cache".
+//
+// Later loads map the cache file and hand the mapped vertices and indices straight
+// to glBufferData: no parsing, no copy. The cache is rebuilt when its version,
+// the vertex format or the source's size or modification time changed; without the
+// source a valid cache is used as is.
+//
+// One mesh per file: objects, groups and materials are merged, polygons become
+// triangle fans, missing normals are the face normal, missing texcoords are 0.
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vertex_format.h>
+#include <meshopt.h>
+#include <gl_state.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define MESH_CACHE_VERSION 1
+
+// what the lighting shaders read: 0 aPos, 1 aNormal, 3 aTexCoords
+typedef VertexFormat<Position3f, Normal3f, TexCoord2f> MeshFormat;
+
+struct MeshData {
+    std::vector<MeshFormat::Vertex> vertices;
+    std::vector<unsigned int> indices;
+    glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
+};
+
+struct MeshCacheHeader {
+    char magic[4];                          // "MESH"
+    uint32_t version;
+    uint32_t stride;                        // MeshFormat::stride
+    uint32_t vertexCount, indexCount;
+    uint32_t indexType;                     // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    float boundsMin[3], boundsMax[3];
+};
+// the vertices follow the header, then the indices
+
+
+// read-only mapping of a whole file
+class MappedFile {
+public:
+    const unsigned char* data = NULL;
+    size_t size = 0;
+
+    MappedFile() {}
+
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const char* path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER length;
+        if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+            close();
+            return false;
+        }
+        size = (size_t)length.QuadPart;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL) data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            close();
+            return false;
+        }
+        size = (size_t)info.st_size;
+        void* view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) data = (const unsigned char*)view;
+#endif
+        if (data == NULL) close();
+        return data != NULL;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data != NULL) UnmapViewOfFile(data);
+        if (mapping != NULL) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data != NULL) munmap((void*)data, size);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        data = NULL;
+        size = 0;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = NULL;
+#else
+    int fd = -1;
+#endif
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+
+// one chunk of an OBJ file, parsed on its own thread
+struct ObjChunk {
+    const char* begin;
+    const char* end;
+    std::vector<float> positions, texcoords, normals;  // 3, 2, 3 floats
+    std::vector<int> corners;                           // v, vt, vn per triangle corner
+    size_t firstPosition = 0, firstTexcoord = 0, firstNormal = 0;    // prefix sums over the chunks
+};
+
+// relative (negative) indices are stored chunk-local, shifted below OBJ_LOCAL_INDEX;
+// the chunk's prefix sum resolves them. 0 is "absent", positive indices are absolute (1-based)
+#define OBJ_LOCAL_INDEX (1 << 30)
+
+inline const char* obj_skip_space(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+inline const char* obj_next_line(const char* p, const char* end) {
+    while (p < end && *p != '\n') p++;
+    return p < end ? p + 1 : end;
+}
+
+// decimal with optional fraction and exponent; locale independent, unlike strtof
+inline float obj_parse_float(const char*& p, const char* end) {
+    p = obj_skip_space(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    double value = 0.0;
+    while (p < end && *p >= '0' && *p <= '9') value = value * 10.0 + (*p++ - '0');
+    if (p < end && *p == '.') {
+        p++;
+        double scale = 0.1;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value += (*p++ - '0') * scale;
+            scale *= 0.1;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) negativeExponent = *p++ == '-';
+        int exponent = 0;
+        while (p < end && *p >= '0' && *p <= '9') exponent = exponent * 10 + (*p++ - '0');
+        value *= pow(10.0, negativeExponent ? -exponent : exponent);
+    }
+    return (float)(negative ? -value : value);
+}
+
+// one index of a face corner; count is how many elements the chunk has read so far
+inline int obj_parse_index(const char*& p, const char* end, size_t count) {
+    bool negative = p < end && *p == '-';
+    if (negative) p++;
+    int value = 0;
+    while (p < end && *p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+    if (value == 0) return 0;
+    if (!negative) return value;
+    return (int)count - value + 1 - OBJ_LOCAL_INDEX;
+}
+
+inline void obj_parse_chunk(ObjChunk& chunk) {
+    const char* end = chunk.end;
+    std::vector<int> face;
+    for (const char* p = chunk.begin; p < end; p = obj_next_line(p, end)) {
+        p = obj_skip_space(p, end);
+        if (p + 1 >= end) continue;
+        if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            p++;
+            for (int i = 0; i < 3; i++) chunk.positions.push_back(obj_parse_float(p, end));
+        }
+        else if (p[0] == 'v' && p[1] == 't') {
+            p += 2;
+            for (int i = 0; i < 2; i++) chunk.texcoords.push_back(obj_parse_float(p, end));
+        }
+        else if (p[0] == 'v' && p[1] == 'n') {
+            p += 2;
+            for (int i = 0; i < 3; i++) chunk.normals.push_back(obj_parse_float(p, end));
+        }
+        else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            // v, v/vt, v//vn or v/vt/vn
+            face.clear();
+            p = obj_skip_space(p + 1, end);
+            while (p < end && *p != '\n') {
+                int v = obj_parse_index(p, end, chunk.positions.size() / 3), vt = 0, vn = 0;
+                if (p < end && *p == '/') {
+                    p++;
+                    if (p < end && *p != '/') vt = obj_parse_index(p, end, chunk.texcoords.size() / 2);
+                    if (p < end && *p == '/') {
+                        p++;
+                        vn = obj_parse_index(p, end, chunk.normals.size() / 3);
+                    }
+                }
+                while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;   // malformed token
+                if (v != 0) {
+                    face.push_back(v);
+                    face.push_back(vt);
+                    face.push_back(vn);
+                }
+                p = obj_skip_space(p, end);
+            }
+            // triangle fan around the first corner
+            for (size_t i = 2; i < face.size() / 3; i++) {
+                chunk.corners.insert(chunk.corners.end(), face.begin(), face.begin() + 3);
+                chunk.corners.insert(chunk.corners.end(), face.begin() + (i - 1) * 3, face.begin() + (i + 1) * 3);
+            }
+        }
+    }
+}
+
+// 0-based global index, -1 when absent or out of range
+inline long long obj_resolve(int index, size_t first, size_t count) {
+    long long resolved;
+    if (index == 0) return -1;
+    if (index > 0) resolved = index - 1;
+    else resolved = (long long)first + (index + OBJ_LOCAL_INDEX) - 1;
+    return resolved >= 0 && resolved < (long long)count ? resolved : -1;
+}
+
+// parse `size` bytes of OBJ text into un-welded triangle vertices (3 per triangle)
+inline bool import_obj(const char* text, size_t size, MeshData& mesh, unsigned int threads = 0) {
+    if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+    if (size < (1 << 20)) threads = 1;      // a thread costs more than a small file
+
+    // chunks end at line boundaries
+    std::vector<ObjChunk> chunks(threads);
+    const char* end = text + size;
+    const char* p = text;
+    for (unsigned int i = 0; i < threads; i++) {
+        chunks[i].begin = p;
+        const char* cut = i + 1 == threads ? end : std::max(p, text + size / threads * (i + 1));
+        chunks[i].end = cut < end ? obj_next_line(cut, end) : end;
+        p = chunks[i].end;
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; i++) workers.push_back(std::thread(obj_parse_chunk, std::ref(chunks[i])));
+    obj_parse_chunk(chunks[0]);
+    for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+    workers.clear();
+
+    // every element in file order, and where each chunk's elements start
+    std::vector<float> positions, texcoords, normals;
+    std::vector<size_t> firstCorner(threads + 1, 0);
+    for (unsigned int i = 0; i < threads; i++) {
+        chunks[i].firstPosition = positions.size() / 3;
+        chunks[i].firstTexcoord = texcoords.size() / 2;
+        chunks[i].firstNormal = normals.size() / 3;
+        positions.insert(positions.end(), chunks[i].positions.begin(), chunks[i].positions.end());
+        texcoords.insert(texcoords.end(), chunks[i].texcoords.begin(), chunks[i].texcoords.end());
+        normals.insert(normals.end(), chunks[i].normals.begin(), chunks[i].normals.end());
+        firstCorner[i + 1] = firstCorner[i] + chunks[i].corners.size() / 3;
+    }
+    if (firstCorner[threads] == 0) return false;
+
+    // faces to vertices, each chunk into its own range
+    mesh.vertices.resize(firstCorner[threads]);
+    auto expand = [&](unsigned int c) {
+        const ObjChunk& chunk = chunks[c];
+        MeshFormat::Vertex* out = mesh.vertices.data() + firstCorner[c];     // one past the end for an empty last chunk
+        size_t positionCount = positions.size() / 3, texcoordCount = texcoords.size() / 2, normalCount = normals.size() / 3;
+        for (size_t t = 0; t < chunk.corners.size(); t += 9) {
+            glm::vec3 corner[3];
+            for (int k = 0; k < 3; k++) {
+                long long v = obj_resolve(chunk.corners[t + k * 3], chunk.firstPosition, positionCount);
+                corner[k] = v >= 0 ? glm::vec3(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]) : glm::vec3(0.0f);
+            }
+            glm::vec3 faceNormal = glm::cross(corner[1] - corner[0], corner[2] - corner[0]);
+            float length = glm::length(faceNormal);
+            faceNormal = length > 0.0f ? faceNormal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+
+            for (int k = 0; k < 3; k++, out++) {
+                long long vt = obj_resolve(chunk.corners[t + k * 3 + 1], chunk.firstTexcoord, texcoordCount);
+                long long vn = obj_resolve(chunk.corners[t + k * 3 + 2], chunk.firstNormal, normalCount);
+                out->set<Position3f>(corner[k]);
+                out->set<Normal3f>(vn >= 0 ? glm::vec3(normals[vn * 3], normals[vn * 3 + 1], normals[vn * 3 + 2]) : faceNormal);
+                out->set<TexCoord2f>(vt >= 0 ? glm::vec2(texcoords[vt * 2], texcoords[vt * 2 + 1]) : glm::vec2(0.0f));
+            }
+        }
+    };
+    for (unsigned int i = 1; i < threads; i++) workers.push_back(std::thread(expand, i));
+    expand(0);
+    for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+
+    mesh.indices.resize(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.indices.size(); i++) mesh.indices[i] = (unsigned int)i;
+
+    mesh.boundsMin = glm::vec3(1e30f);
+    mesh.boundsMax = glm::vec3(-1e30f);
+    for (size_t i = 0; i < positions.size(); i += 3) {
+        glm::vec3 position(positions[i], positions[i + 1], positions[i + 2]);
+        mesh.boundsMin = glm::min(mesh.boundsMin, position);
+        mesh.boundsMax = glm::max(mesh.boundsMax, position);
+    }
+    return true;
+}
+
+
+// an imported mesh in its own VAO/VBO/EBO
+class MeshAsset {
+public:
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    unsigned int vertexCount = 0, indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
+
+    // how the last load() went
+    bool fromCache = false;
+    double loadMilliseconds = 0.0;
+
+    MeshAsset() {}
+
+    ~MeshAsset() {
+        if (VAO != 0) gl_state().deleteVertexArrays(1, &VAO);
+        if (VBO != 0) gl_state().deleteBuffers(1, &VBO);
+        if (EBO != 0) gl_state().deleteBuffers(1, &EBO);
+    }
+
+    // whether load() has anything to read: the source or a cache written from it
+    static bool available(const char* path) {
+        struct stat info;
+        return stat(path, &info) == 0 || stat((std::string(path) + ".cache").c_str(), &info) == 0;
+    }
+
+    // the cache when it is current, otherwise import `path` and rewrite the cache
+    bool load(const char* path, unsigned int threads = 0) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        MappedFile cache;
+        fromCache = openCache(path, cache);
+        if (fromCache) {
+            const MeshCacheHeader* header = (const MeshCacheHeader*)cache.data;
+            const unsigned char* vertices = cache.data + sizeof(MeshCacheHeader);
+            upload(*header, vertices, vertices + (size_t)header->vertexCount * MeshFormat::stride);
+        }
+        else {
+            MeshData mesh;
+            IndexData packed;
+            MeshCacheHeader header;
+            if (!importMesh(path, threads, mesh, packed, header)) {
+                std::cout << "MESH: " << path << " could not be imported" << std::endl;
+                return false;
+            }
+            upload(header, mesh.vertices.data(), packed.data());
+        }
+
+        loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "MESH: " << path << " " << vertexCount << " vertices, " << indexCount / 3 << " triangles, "
+                  << (fromCache ? "mapped from the cache" : "imported") << " in " << loadMilliseconds << " ms" << std::endl;
+        return true;
+    }
+
+    glm::vec3 center() const {
+        return (boundsMin + boundsMax) * 0.5f;
+    }
+
+    float radius() const {
+        return glm::length(boundsMax - boundsMin) * 0.5f;
+    }
+
+    // maps "<path>.cache" when it is current for `path`; no GL calls
+    static bool openCache(const char* path, MappedFile& cache) {
+        struct stat source;
+        bool haveSource = stat(path, &source) == 0;
+        uint64_t sourceSize = haveSource ? (uint64_t)source.st_size : 0;
+        int64_t sourceTime = haveSource ? (int64_t)source.st_mtime : 0;
+
+        if (cache.open((std::string(path) + ".cache").c_str()) && validCache(cache, haveSource, sourceSize, sourceTime))
+            return true;
+        cache.close();
+        return false;
+    }
+
+    // imports `path`, welds and reorders it and writes "<path>.cache"; the welded mesh,
+    // its packed indices and the cache header are returned. No GL calls
+    static bool importMesh(const char* path, unsigned int threads, MeshData& mesh, IndexData& packed, MeshCacheHeader& header) {
+        struct stat source;
+        MappedFile text;
+        if (stat(path, &source) != 0 || !text.open(path) || !import_obj((const char*)text.data, text.size, mesh, threads))
+            return false;
+        size_t welded = weld_vertices(mesh.vertices, 1, mesh.indices);
+        optimize_vertex_cache(mesh.indices, welded);
+        optimize_vertex_fetch(mesh.vertices, 1, mesh.indices);
+        packed = pack_indices(mesh.indices, mesh.vertices.size());
+
+        memcpy(header.magic, "MESH", 4);
+        header.version = MESH_CACHE_VERSION;
+        header.stride = (uint32_t)MeshFormat::stride;
+        header.vertexCount = (uint32_t)mesh.vertices.size();
+        header.indexCount = (uint32_t)packed.count;
+        header.indexType = packed.type;
+        header.sourceSize = (uint64_t)source.st_size;
+        header.sourceTime = (int64_t)source.st_mtime;
+        memcpy(header.boundsMin, &mesh.boundsMin[0], sizeof(header.boundsMin));
+        memcpy(header.boundsMax, &mesh.boundsMax[0], sizeof(header.boundsMax));
+
+        std::string cachePath = std::string(path) + ".cache";
+        std::ofstream out(cachePath.c_str(), std::ios::binary);
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)mesh.vertices.data(), mesh.vertices.size() * MeshFormat::stride);
+        out.write((const char*)packed.data(), packed.size());
+        if (!out) std::cout << "MESH: cannot write " << cachePath << std::endl;
+        return true;
+    }
+
+    static size_t indexSize(uint32_t type) {
+        return type == GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+
+private:
+
+    static bool validCache(const MappedFile& cache, bool haveSource, uint64_t sourceSize, int64_t sourceTime) {
+        if (cache.size < sizeof(MeshCacheHeader)) return false;
+        const MeshCacheHeader* header = (const MeshCacheHeader*)cache.data;
+        if (memcmp(header->magic, "MESH", 4) != 0 || header->version != MESH_CACHE_VERSION
+            || header->stride != MeshFormat::stride) return false;
+        if (haveSource && (header->sourceSize != sourceSize || header->sourceTime != sourceTime)) return false;
+        if (header->indexType != GL_UNSIGNED_SHORT && header->indexType != GL_UNSIGNED_INT) return false;
+        return cache.size == sizeof(MeshCacheHeader) + (size_t)header->vertexCount * MeshFormat::stride
+                             + (size_t)header->indexCount * indexSize(header->indexType);
+    }
+
+    void upload(const MeshCacheHeader& header, const void* vertices, const void* indices) {
+        vertexCount = header.vertexCount;
+        indexCount = header.indexCount;
+        indexType = header.indexType;
+        boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+        if (VAO == 0) {
+            glGenVertexArrays(1, &VAO);
+            glGenBuffers(1, &VBO);
+            glGenBuffers(1, &EBO);
+        }
+        gl_state().bindVertexArray(VAO);
+        gl_state().bindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCount * MeshFormat::stride, vertices, GL_STATIC_DRAW);
+        MEMORY_TRACK_BUFFER(VBO, (size_t)vertexCount * MeshFormat::stride, MEMORY_VERTEX, "imported mesh");
+        gl_state().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexCount * indexSize(indexType), indices, GL_STATIC_DRAW);
+        MEMORY_TRACK_BUFFER(EBO, (size_t)indexCount * indexSize(indexType), MEMORY_INDEX, "imported mesh");
+        MeshFormat::setup();
+        gl_state().bindVertexArray(0);
+    }
+
+    MeshAsset(const MeshAsset&);
+    MeshAsset& operator=(const MeshAsset&);
+};
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef MESHOPT_H
+#define MESHOPT_H
+
+// At-load mesh optimizer for indexed triangle lists.
+//      weld_vertices        : merge bit-identical vertices
+//      optimize_vertex_cache: reorder triangles for post-transform cache reuse (Forsyth)
+//      optimize_vertex_fetch: reorder vertices in first-use order
+//      pack_indices         : 16-bit indices when every vertex fits, 32-bit otherwise
+//
+// Vertices are interleaved records of `stride` elements (floats, or packed
+// VertexFormat<...>::Vertex structs with stride 1).
+
+#include <GL/glew.h>
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+#define MESHOPT_CACHE_SIZE 32
+
+// indices packed for glBufferData / glDrawElements
+struct IndexData {
+    GLenum type;                    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    size_t count;
+    std::vector<unsigned char> bytes;
+
+    size_t size() const { return bytes.size(); }
+    const void* data() const { return bytes.data(); }
+};
+
+// merge vertices whose attributes are bit-identical, rewrite indices.
+// returns the new vertex count.
+template <typename T>
+size_t weld_vertices(std::vector<T>& vertices, int stride, std::vector<unsigned int>& indices) {
+    size_t vertexCount = vertices.size() / stride;
+    size_t tableSize = 1;
+    while (tableSize < vertexCount * 2) tableSize <<= 1;
+
+    // open addressing table of unique vertex ids, ~0u is empty
+    std::vector<unsigned int> table(tableSize, ~0u);
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<T> unique;
+    unique.reserve(vertices.size());
+    size_t recordSize = stride * sizeof(T);
+
+    for (size_t v = 0; v < vertexCount; v++) {
+        const T* record = &vertices[v * stride];
+
+        // FNV-1a over the raw bytes
+        unsigned int hash = 2166136261u;
+        const unsigned char* bytes = (const unsigned char*)record;
+        for (size_t i = 0; i < recordSize; i++) {
+            hash ^= bytes[i];
+            hash *= 16777619u;
+        }
+
+        size_t slot = hash & (tableSize - 1);
+        while (table[slot] != ~0u && memcmp(&unique[table[slot] * stride], record, recordSize) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+
+        if (table[slot] == ~0u) {
+            table[slot] = (unsigned int)(unique.size() / stride);
+            unique.insert(unique.end(), record, record + stride);
+        }
+        remap[v] = table[slot];
+    }
+
+    for (size_t i = 0; i < indices.size(); i++)
+        indices[i] = remap[indices[i]];
+    vertices.swap(unique);
+    return vertices.size() / stride;
+}
+
+// Forsyth's vertex score: recently used vertices and vertices with few
+// remaining triangles score higher.
+inline float meshopt_vertex_score(int cachePos, unsigned int remainingTris) {
+    if (remainingTris == 0) return -1.0f;
+
+    float score = 0.0f;
+    if (cachePos >= 0) {
+        if (cachePos < 3) {
+            // the last triangle's vertices get a fixed score so the next triangle
+            // does not simply reuse the same edge
+            score = 0.75f;
+        }
+        else {
+            float scaler = 1.0f / (MESHOPT_CACHE_SIZE - 3);
+            score = powf(1.0f - (cachePos - 3) * scaler, 1.5f);
+        }
+    }
+    score += 2.0f * powf((float)remainingTris, -0.5f);
+    return score;
+}
+
+// reorder triangles (in place) to maximize post-transform vertex cache hits
+inline void optimize_vertex_cache(std::vector<unsigned int>& indices, size_t vertexCount) {
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) return;
+
+    // vertex -> triangle adjacency
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    std::vector<unsigned int> triOffset(vertexCount + 1, 0);
+    for (size_t i = 0; i < indices.size(); i++)
+        remaining[indices[i]]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        triOffset[v + 1] = triOffset[v] + remaining[v];
+
+    std::vector<unsigned int> triList(indices.size());
+    std::vector<unsigned int> cursor(triOffset.begin(), triOffset.end() - 1);
+    for (size_t t = 0; t < triCount; t++)
+        for (int k = 0; k < 3; k++)
+            triList[cursor[indices[t * 3 + k]]++] = (unsigned int)t;
+
+    std::vector<int> cachePos(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = meshopt_vertex_score(-1, remaining[v]);
+
+    std::vector<float> triScore(triCount);
+    std::vector<char> emitted(triCount, 0);
+    int best = -1;
+    for (size_t t = 0; t < triCount; t++) {
+        triScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (best < 0 || triScore[t] > triScore[best]) best = (int)t;
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    std::vector<unsigned int> cache, newCache;
+    size_t scan = 0;
+
+    for (size_t n = 0; n < triCount; n++) {
+        if (best < 0) {
+            // no cached vertex has triangles left: continue with the next unused triangle
+            while (emitted[scan]) scan++;
+            best = (int)scan;
+        }
+
+        const unsigned int* tri = &indices[best * 3];
+        emitted[best] = 1;
+        result.insert(result.end(), tri, tri + 3);
+
+        // remove the triangle from its vertices' adjacency
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = tri[k];
+            unsigned int* list = &triList[triOffset[v]];
+            for (unsigned int i = 0; i < remaining[v]; i++) {
+                if (list[i] == (unsigned int)best) {
+                    list[i] = list[remaining[v] - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // move the triangle's vertices to the front of the LRU cache
+        newCache.assign(tri, tri + 3);
+        for (size_t i = 0; i < cache.size(); i++)
+            if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2])
+                newCache.push_back(cache[i]);
+
+        for (size_t i = 0; i < newCache.size(); i++) {
+            unsigned int v = newCache[i];
+            cachePos[v] = i < MESHOPT_CACHE_SIZE ? (int)i : -1;
+            vertexScore[v] = meshopt_vertex_score(cachePos[v], remaining[v]);
+        }
+
+        // rescore the triangles touching the cache and pick the best one
+        best = -1;
+        for (size_t i = 0; i < newCache.size(); i++) {
+            unsigned int v = newCache[i];
+            for (unsigned int j = 0; j < remaining[v]; j++) {
+                unsigned int t = triList[triOffset[v] + j];
+                triScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                if (best < 0 || triScore[t] > triScore[best]) best = (int)t;
+            }
+        }
+
+        if (newCache.size() > MESHOPT_CACHE_SIZE) newCache.resize(MESHOPT_CACHE_SIZE);
+        cache.swap(newCache);
+    }
+
+    indices.swap(result);
+}
+
+// reorder vertices (in place) in the order the index buffer first references them
+template <typename T>
+void optimize_vertex_fetch(std::vector<T>& vertices, int stride, std::vector<unsigned int>& indices) {
+    size_t vertexCount = vertices.size() / stride;
+    std::vector<unsigned int> remap(vertexCount, ~0u);
+    std::vector<T> ordered;
+    ordered.reserve(vertices.size());
+
+    for (size_t i = 0; i < indices.size(); i++) {
+        unsigned int v = indices[i];
+        if (remap[v] == ~0u) {
+            remap[v] = (unsigned int)(ordered.size() / stride);
+            ordered.insert(ordered.end(), &vertices[v * stride], &vertices[v * stride] + stride);
+        }
+        indices[i] = remap[v];
+    }
+
+    // unreferenced vertices are dropped
+    vertices.swap(ordered);
+}
+
+// average cache miss ratio (vertex shader invocations per triangle) of a FIFO cache
+inline float average_cache_miss_ratio(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize = 16) {
+    if (indices.empty()) return 0.0f;
+
+    std::vector<unsigned int> fifo(cacheSize, ~0u);
+    std::vector<char> cached(vertexCount, 0);
+    int head = 0;
+    unsigned int misses = 0;
+
+    for (size_t i = 0; i < indices.size(); i++) {
+        unsigned int v = indices[i];
+        if (cached[v]) continue;
+        misses++;
+        if (fifo[head] != ~0u) cached[fifo[head]] = 0;
+        fifo[head] = v;
+        cached[v] = 1;
+        head = (head + 1) % cacheSize;
+    }
+    return misses / (float)(indices.size() / 3);
+}
+
+// 16-bit indices halve the index bandwidth whenever the vertex count allows
+inline IndexData pack_indices(const std::vector<unsigned int>& indices, size_t vertexCount) {
+    IndexData out;
+    out.count = indices.size();
+
+    if (vertexCount <= 0xFFFF) {
+        out.type = GL_UNSIGNED_SHORT;
+        out.bytes.resize(indices.size() * sizeof(unsigned short));
+        unsigned short* dst = (unsigned short*)out.bytes.data();
+        for (size_t i = 0; i < indices.size(); i++)
+            dst[i] = (unsigned short)indices[i];
+    }
+    else {
+        out.type = GL_UNSIGNED_INT;
+        out.bytes.resize(indices.size() * sizeof(unsigned int));
+        memcpy(out.bytes.data(), indices.data(), out.bytes.size());
+    }
+    return out;
+}
+
+#endif
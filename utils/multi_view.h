@@ -0,0 +1,102 @@
+#ifndef MULTI_VIEW_H
+#define MULTI_VIEW_H
+
+// Several cameras drawn in one pass over the geometry.
+//      MultiView views;
+//      views.setView(0, view, projection, 0, 0, w / 2, h / 2);     // window pixels
+//      views.setView(1, topView, projection, w / 2, 0, w / 2, h / 2);
+//      ...
+//      views.apply(multiViewShader->ID);       // matrices, viewports, view count
+//      cube->draw(multiViewShader);            // one draw call reaches every viewport
+//
+// The vertex shader only moves vertices to world space. The geometry shader
+// (multiview.gs) emits each triangle once per view with that view's
+// projection * view from the uniform block "Views", and routes the copy to its
+// viewport with gl_ViewportIndex. A copy entirely outside one clip plane of a view is
+// not emitted. The CPU issues the same calls whatever the view count; the views only
+// cost GPU time.
+//
+// Needs ARB_viewport_array (core in GL 4.1). Without it supported() is false and the
+// caller draws once per view with viewRect() / viewMatrix() / projectionMatrix().
+// Writing gl_ViewportIndex from the vertex shader of an instanced draw
+// (ARB_shader_viewport_layer_array) would skip the geometry shader. Meshes drawn by
+// code that cannot be instanced, like the course Cube, need the geometry shader.
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <gl_state.h>
+
+#define MULTI_VIEW_MAX 4            // MAX_VIEWS in multiview.gs
+#define MULTI_VIEW_BINDING 4        // uniform buffer binding of the "Views" block
+
+class MultiView {
+public:
+    int count = 0;
+    unsigned int viewBuffer = 0;    // std140: mat4 viewProjection[MULTI_VIEW_MAX]
+
+    static bool supported() {
+        return GLEW_ARB_viewport_array != 0;
+    }
+
+    MultiView() {
+        glGenBuffers(1, &viewBuffer);
+        gl_state().bindBuffer(GL_UNIFORM_BUFFER, viewBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(viewProjection), NULL, GL_DYNAMIC_DRAW);
+        MEMORY_TRACK_BUFFER(viewBuffer, sizeof(viewProjection), MEMORY_BUFFER, "view matrices");
+    }
+
+    ~MultiView() {
+        gl_state().deleteBuffers(1, &viewBuffer);
+    }
+
+    // view i covers the window rectangle (x, y, width, height); count grows to include it
+    void setView(int i, const glm::mat4& view, const glm::mat4& projection, float x, float y, float width, float height) {
+        if (i < 0 || i >= MULTI_VIEW_MAX) return;
+        views[i] = view;
+        projections[i] = projection;
+        viewProjection[i] = projection * view;
+        rects[i * 4] = x;
+        rects[i * 4 + 1] = y;
+        rects[i * 4 + 2] = width;
+        rects[i * 4 + 3] = height;
+        if (i >= count) count = i + 1;
+        dirty = true;
+    }
+
+    // program: linked with multiview.gs; it stays current for the draw
+    void apply(unsigned int program) {
+        gl_state().useProgram(program);
+        if (program != boundProgram) {
+            GLuint block = glGetUniformBlockIndex(program, "Views");
+            if (block != GL_INVALID_INDEX) glUniformBlockBinding(program, block, MULTI_VIEW_BINDING);
+            viewCountLocation = glGetUniformLocation(program, "viewCount");
+            boundProgram = program;
+        }
+        if (dirty) {
+            gl_state().bindBuffer(GL_UNIFORM_BUFFER, viewBuffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, count * sizeof(glm::mat4), viewProjection);
+            dirty = false;
+        }
+        gl_state().bindBufferBase(GL_UNIFORM_BUFFER, MULTI_VIEW_BINDING, viewBuffer);
+        glUniform1i(viewCountLocation, count);
+        gl_state().viewportArray(0, count, rects);
+    }
+
+    const glm::mat4& viewMatrix(int i) const { return views[i]; }
+    const glm::mat4& projectionMatrix(int i) const { return projections[i]; }
+    const GLfloat* viewRect(int i) const { return rects + i * 4; }
+
+private:
+    glm::mat4 views[MULTI_VIEW_MAX];
+    glm::mat4 projections[MULTI_VIEW_MAX];
+    glm::mat4 viewProjection[MULTI_VIEW_MAX];
+    GLfloat rects[MULTI_VIEW_MAX * 4];
+    bool dirty = true;
+    unsigned int boundProgram = 0;
+    GLint viewCountLocation = -1;
+
+    MultiView(const MultiView&);
+    MultiView& operator=(const MultiView&);
+};
+
+#endif
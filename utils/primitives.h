@@ -0,0 +1,169 @@
+#ifndef PRIMITIVES_H
+#define PRIMITIVES_H
+
+// Compile-time primitive tables.
+//      Prism<6>::tables.vertices / .normals / .colors / .texCoords / .indices
+//      CylinderShape<48, SHADING_SMOOTH>::tables.vertices ...
+//
+// The same tables the runtime generators fill (hex_prism_vertice_mapping() in
+// hexprism.h, Cylinder::dynamic_vertice_mapping() in HW09), computed by the compiler:
+// static constexpr data in read-only memory, nothing to fill at startup. Every array
+// is sized by the template arguments, and the indices use the smallest GL index type
+// that holds the vertex count (IndexType). The trig is the series below, rounded
+// to float like the runtime tables.
+//
+// The tables are not bit-identical to the generators. The series and the library
+// sin/cos sometimes round to neighbouring floats, and near zero the difference shows
+// in the last bits (cos(pi / 2) of a float angle, about -4.4e-8) or, for a double
+// angle, even the sign (sin(pi), about 1.2e-16). Benchmarks/GeometryBench/PrimitivesTest
+// checks every table against its generator to 2 ulps or 1e-12.
+//
+// Constant expressions with loops need C++14.
+
+#include <GL/glew.h>
+#include <type_traits>
+
+#define PRIMITIVE_PI 3.14159265358979323846
+
+enum Shading {
+    SHADING_SMOOTH = 0,             // side normals follow the circle
+    SHADING_FLAT = 1                // every vertex of a side face has the face normal
+};
+
+// sin/cos as constant expressions: reduction to [-pi, pi], then the Taylor series
+constexpr double ct_reduce(double x) {
+    double turns = x / (2.0 * PRIMITIVE_PI);
+    long long whole = (long long)(turns < 0.0 ? turns - 0.5 : turns + 0.5);
+    return x - (double)whole * (2.0 * PRIMITIVE_PI);
+}
+
+constexpr double ct_sin(double x) {
+    x = ct_reduce(x);
+    double term = x, sum = x;
+    for (int k = 1; k < 20; k++) {
+        term *= -x * x / ((2 * k) * (2 * k + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double ct_cos(double x) {
+    return ct_sin(x + PRIMITIVE_PI / 2.0);
+}
+
+// 16 bit indices while every vertex fits, like pack_indices()
+template <unsigned int VertexCount>
+struct IndexType {
+    typedef typename std::conditional<(VertexCount <= 65536), unsigned short, unsigned int>::type type;
+    static constexpr GLenum gl = VertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+};
+
+
+// N side faces, each a quad of 4 vertices, 2 triangles
+template <int N>
+struct PrismTables {
+    GLfloat vertices[N * 12];       // vec3
+    GLfloat normals[N * 12];        // vec3
+    GLfloat colors[N * 16];         // vec4
+    GLfloat texCoords[N * 8];       // vec2
+    typename IndexType<N * 4>::type indices[N * 6];
+};
+
+// hex_prism_vertice_mapping() for any N, with its per-vertex normals and colors
+template <int N>
+constexpr PrismTables<N> prism_tables() {
+    PrismTables<N> t{};
+    for (int i = 0; i < N; i++) {
+        double a0 = i * 2.0 * PRIMITIVE_PI / N, a1 = (i + 1) * 2.0 * PRIMITIVE_PI / N;
+        GLfloat corners[12] = {
+            (GLfloat)ct_sin(a0), -1, (GLfloat)ct_cos(a0),
+            (GLfloat)ct_sin(a0), 1, (GLfloat)ct_cos(a0),
+            (GLfloat)ct_sin(a1), 1, (GLfloat)ct_cos(a1),
+            (GLfloat)ct_sin(a1), -1, (GLfloat)ct_cos(a1)
+        };
+        GLfloat normals[12] = { 0, 0, -1, 0, 0, 1, 0, 0, 1, 0, 0, -1 };
+        GLfloat colors[16] = { 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 0, 1, 0, 0, 1, 1 };
+        GLfloat texCoords[8] = {
+            (GLfloat)i / N, 1, (GLfloat)i / N, 0,
+            (GLfloat)(i + 1) / N, 0, (GLfloat)(i + 1) / N, 1
+        };
+        for (int k = 0; k < 12; k++) t.vertices[i * 12 + k] = corners[k];
+        for (int k = 0; k < 12; k++) t.normals[i * 12 + k] = normals[k];
+        for (int k = 0; k < 16; k++) t.colors[i * 16 + k] = colors[k];
+        for (int k = 0; k < 8; k++) t.texCoords[i * 8 + k] = texCoords[k];
+
+        int quad[6] = { 0, 1, 2, 0, 2, 3 };
+        for (int k = 0; k < 6; k++) t.indices[i * 6 + k] = (typename IndexType<N * 4>::type)(i * 4 + quad[k]);
+    }
+    return t;
+}
+
+template <int N>
+struct Prism {
+    static_assert(N >= 3, "a prism needs at least 3 sides");
+    static constexpr int vertexCount = N * 4;
+    static constexpr int indexCount = N * 6;
+    static constexpr GLenum indexType = IndexType<N * 4>::gl;
+    static constexpr PrismTables<N> tables = prism_tables<N>();
+};
+template <int N> constexpr PrismTables<N> Prism<N>::tables;
+
+
+// side faces of a cylinder of radius 1 and height 2, as the HW09 Cylinder generates them
+template <int N>
+struct CylinderTables {
+    GLfloat vertices[N * 12];       // vec3
+    GLfloat normals[N * 12];        // vec3
+    GLfloat colors[N * 12];         // vec3
+    GLfloat texCoords[N * 8];       // vec2
+    typename IndexType<N * 4>::type indices[N * 6];
+};
+
+// the runtime generator steps a float angle; so does this one, to produce the same floats
+template <int N, Shading S>
+constexpr CylinderTables<N> cylinder_tables() {
+    CylinderTables<N> t{};
+    float angle = (float)(2 * PRIMITIVE_PI / N);
+    for (int i = 0; i < N; i++) {
+        double p0 = (float)(i * angle), p1 = (float)((i + 1) * angle);
+        double n0 = S == SHADING_FLAT ? (float)((i + 0.5f) * angle) : p0;
+        double n1 = S == SHADING_FLAT ? n0 : p1;
+        GLfloat corners[12] = {
+            (GLfloat)ct_sin(p0), -1, (GLfloat)ct_cos(p0),
+            (GLfloat)ct_sin(p0), 1, (GLfloat)ct_cos(p0),
+            (GLfloat)ct_sin(p1), 1, (GLfloat)ct_cos(p1),
+            (GLfloat)ct_sin(p1), -1, (GLfloat)ct_cos(p1)
+        };
+        GLfloat normals[12] = {
+            (GLfloat)ct_sin(n0), 0, (GLfloat)ct_cos(n0),
+            (GLfloat)ct_sin(n0), 0, (GLfloat)ct_cos(n0),
+            (GLfloat)ct_sin(n1), 0, (GLfloat)ct_cos(n1),
+            (GLfloat)ct_sin(n1), 0, (GLfloat)ct_cos(n1)
+        };
+        GLfloat texCoords[8] = { (GLfloat)i / N, 0, (GLfloat)i / N, 1, (GLfloat)(i + 1) / N, 1, (GLfloat)(i + 1) / N, 0 };
+        for (int k = 0; k < 12; k++) t.vertices[i * 12 + k] = corners[k];
+        for (int k = 0; k < 12; k++) t.normals[i * 12 + k] = normals[k];
+        for (int k = 0; k < 12; k += 3) {
+            t.colors[i * 12 + k] = 1.0f;
+            t.colors[i * 12 + k + 1] = 0.5f;
+            t.colors[i * 12 + k + 2] = 0.31f;
+        }
+        for (int k = 0; k < 8; k++) t.texCoords[i * 8 + k] = texCoords[k];
+
+        int quad[6] = { 0, 1, 2, 2, 3, 0 };
+        for (int k = 0; k < 6; k++) t.indices[i * 6 + k] = (typename IndexType<N * 4>::type)(i * 4 + quad[k]);
+    }
+    return t;
+}
+
+template <int N, Shading S>
+struct CylinderShape {
+    static_assert(N >= 3, "a cylinder needs at least 3 segments");
+    static constexpr int vertexCount = N * 4;
+    static constexpr int indexCount = N * 6;
+    static constexpr GLenum indexType = IndexType<N * 4>::gl;
+    static constexpr CylinderTables<N> tables = cylinder_tables<N, S>();
+};
+template <int N, Shading S> constexpr CylinderTables<N> CylinderShape<N, S>::tables;
+
+#endif
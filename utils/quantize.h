@@ -0,0 +1,140 @@
+#ifndef QUANTIZE_H
+#define QUANTIZE_H
+
+// Vertex attribute quantization. Every packed type is decoded by the vertex
+// fetch hardware through normalized (or half float) attributes, so the vertex
+// shaders keep reading plain vec2/vec3/vec4 inputs.
+//
+//      position   vec3  12 bytes -> PositionSnorm16  8 bytes (per-mesh center, uniform extent)
+//      normal     vec3  12 bytes -> Normal1010102    4 bytes
+//                                 -> NormalOct16      4 bytes (needs oct_decode in the shader)
+//      color      vec4  16 bytes -> ColorRGBA8       4 bytes
+//      texcoord   vec2   8 bytes -> TexCoordHalf2    4 bytes
+
+#include <vertex_format.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <cstring>
+
+struct Snorm16x4 { short x, y, z, w; };
+struct Snorm16x2 { short x, y; };
+struct Unorm8x4 { unsigned char r, g, b, a; };
+struct Half2 { unsigned short u, v; };
+
+typedef Attrib<0, Snorm16x4, GL_SHORT, 4, GL_TRUE, 3> PositionSnorm16;
+typedef Attrib<1, GLuint, GL_INT_2_10_10_10_REV, 4, GL_TRUE, 3> Normal1010102;
+typedef Attrib<1, Snorm16x2, GL_SHORT, 2, GL_TRUE> NormalOct16;
+typedef Attrib<2, Unorm8x4, GL_UNSIGNED_BYTE, 4, GL_TRUE> ColorRGBA8;
+typedef Attrib<3, Half2, GL_HALF_FLOAT, 2> TexCoordHalf2;
+
+
+inline float quantize_clamp(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+inline short snorm16(float v) {
+    return (short)floorf(quantize_clamp(v, -1.0f, 1.0f) * 32767.0f + 0.5f);
+}
+
+inline unsigned char unorm8(float v) {
+    return (unsigned char)floorf(quantize_clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// IEEE 754 binary16, round to nearest
+inline unsigned short float_to_half(float f) {
+    unsigned int x;
+    memcpy(&x, &f, sizeof(x));
+    unsigned int sign = (x >> 16) & 0x8000;
+    unsigned int biased = (x >> 23) & 0xFF;
+    unsigned int mant = x & 0x7FFFFF;
+    int exp = (int)biased - 127 + 15;
+
+    if (biased == 0xFF) return (unsigned short)(sign | 0x7C00 | (mant ? 0x200 : 0));    // inf, nan
+    if (exp >= 31) return (unsigned short)(sign | 0x7C00);                              // overflow
+    if (exp <= 0) {
+        // subnormal half
+        if (exp < -10) return (unsigned short)sign;
+        mant |= 0x800000;
+        int shift = 14 - exp;
+        unsigned int half = mant >> shift;
+        if ((mant >> (shift - 1)) & 1) half++;
+        return (unsigned short)(sign | half);
+    }
+    unsigned int half = sign | (exp << 10) | (mant >> 13);
+    if (mant & 0x1000) half++;      // a carry into the exponent is still correct
+    return (unsigned short)half;
+}
+
+// GL_INT_2_10_10_10_REV: x in bits 0-9, y 10-19, z 20-29, w 30-31
+inline GLuint pack_snorm_1010102(const glm::vec3& n) {
+    int x = (int)floorf(quantize_clamp(n.x, -1.0f, 1.0f) * 511.0f + 0.5f);
+    int y = (int)floorf(quantize_clamp(n.y, -1.0f, 1.0f) * 511.0f + 0.5f);
+    int z = (int)floorf(quantize_clamp(n.z, -1.0f, 1.0f) * 511.0f + 0.5f);
+    return (GLuint)(x & 0x3FF) | ((GLuint)(y & 0x3FF) << 10) | ((GLuint)(z & 0x3FF) << 20);
+}
+
+// octahedral normal encoding; decode in GLSL with
+//      vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+//      if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+//      n = normalize(n);
+inline Snorm16x2 oct_encode_snorm16(const glm::vec3& n) {
+    float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    float x = n.x / l1, y = n.y / l1;
+    if (n.z < 0.0f) {
+        float ox = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float oy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = ox;
+        y = oy;
+    }
+    Snorm16x2 e = { snorm16(x), snorm16(y) };
+    return e;
+}
+
+inline Unorm8x4 pack_rgba8(const glm::vec4& c) {
+    Unorm8x4 p = { unorm8(c.x), unorm8(c.y), unorm8(c.z), unorm8(c.w) };
+    return p;
+}
+
+inline Half2 pack_half2(const glm::vec2& t) {
+    Half2 h = { float_to_half(t.x), float_to_half(t.y) };
+    return h;
+}
+
+// per-mesh position range; positions are stored as snorm16 of (p - center) / extent.
+// One extent for all three axes (the largest half size): the decode is a translation and
+// a uniform scale, so folding it into the model matrix leaves the normal matrix
+// transpose(inverse(model)) a rotation times a scale and the lit normals unskewed.
+// A flat axis gives up precision for it (the 6-segment cylinder: x spans 0.866 of z).
+struct PositionQuantization {
+    glm::vec3 center;
+    float extent;
+
+    PositionQuantization() : center(0.0f), extent(1.0f) {}
+
+    // bounding box of `count` positions given as xyz floats
+    PositionQuantization(const float* positions, size_t count) {
+        glm::vec3 lo(positions[0], positions[1], positions[2]), hi = lo;
+        for (size_t i = 1; i < count; i++) {
+            glm::vec3 p(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+            lo = glm::min(lo, p);
+            hi = glm::max(hi, p);
+        }
+        center = (lo + hi) * 0.5f;
+        glm::vec3 half = (hi - lo) * 0.5f;
+        extent = glm::max(glm::max(half.x, half.y), glm::max(half.z, 1e-6f));
+    }
+
+    Snorm16x4 encode(const glm::vec3& p) const {
+        glm::vec3 q = (p - center) / extent;
+        Snorm16x4 e = { snorm16(q.x), snorm16(q.y), snorm16(q.z), 32767 };
+        return e;
+    }
+
+    // multiply into the model matrix to decode positions
+    glm::mat4 decodeMatrix() const {
+        return glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(extent));
+    }
+};
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+// Sort-keyed render queue.
+//      RenderQueue queue;
+//      queue.begin(view, farPlane, resources.frame());    // draw list lives in the frame arena
+//      queue.submit(PASS_OPAQUE, { shader, &material, VAO, GL_TRIANGLES, count, GL_UNSIGNED_INT, model });
+//      ...
+//      queue.execute();            // radix sort by key, then draw with the fewest state changes
+//
+// Each draw gets a 64 bit key, most significant field first:
+//      opaque      pass:2 | shader:10 | material:12 | VAO:16 | depth:24     state, then front-to-back
+//      transparent pass:2 | far depth:24 | shader:10 | material:12 | VAO:16  back-to-front, then state
+// Per-frame uniforms (view, lights) are set on each program before execute();
+// a draw only sets "model" and, when they change, its material and "lodFade".
+//
+// When the depth keys tie, the queue keeps the submission order.
+//
+// The draw list is allocated from the frame arena (resource_manager.h) and doubles there
+// when it fills up; a full arena makes submit() draw what is queued so far and start over.
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <shader_manager.h>
+#include <material_pool.h>
+#include <gl_state.h>
+#include <resource_manager.h>
+#include <cstring>
+#include <cstdint>
+
+enum RenderPass {
+    PASS_OPAQUE = 0,
+    PASS_TRANSPARENT = 1
+};
+
+struct DrawCall {
+    ShaderProgram* shader;
+    const Material* material;       // NULL: the program has no material uniforms
+    unsigned int VAO;
+    GLenum mode;
+    GLsizei count;
+    GLenum indexType;               // 0: glDrawArrays
+    glm::mat4 model;
+    size_t indexOffset;             // bytes into the element buffer
+    GLint baseVertex;               // meshes in a shared GeometryArena
+    float lodFade;                  // LOD cross-fade dither (lod.h), 0: off
+};
+
+#define RENDER_QUEUE_INITIAL_DRAWS 256
+
+struct SortItem {
+    uint64_t key;
+    unsigned int index;
+};
+
+// LSD radix sort, 8 bits per pass; a pass is skipped when every key has the same byte there
+// scratch holds at least count items; the sorted items end up in whichever array items points to
+inline void radix_sort(SortItem*& items, SortItem*& scratch, size_t count) {
+    if (count < 2) return;
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = { 0 };
+        for (size_t i = 0; i < count; i++) counts[(items[i].key >> shift) & 0xFF]++;
+        if (counts[(items[0].key >> shift) & 0xFF] == count) continue;
+
+        size_t offset = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t c = counts[b];
+            counts[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < count; i++)
+            scratch[counts[(items[i].key >> shift) & 0xFF]++] = items[i];
+        std::swap(items, scratch);
+    }
+}
+
+// the material field groups draws with the same maps
+inline uint64_t material_key(const Material* material) {
+    if (material == NULL) return 0;
+    return (uint64_t)(((material->diffuseLayer + 1) & 0x3F) << 6 | ((material->specularLayer + 1) & 0x3F));
+}
+
+class RenderQueue {
+public:
+    // statistics of the last execute()
+    unsigned int draws = 0;
+    unsigned int shaderChanges = 0, materialChanges = 0, vaoChanges = 0;
+
+    RenderQueue() {}
+
+    // camera of the frame: depth keys are view distances scaled by farPlane. The draw list
+    // is valid until the frame arena is reset
+    void begin(const glm::mat4& view, float farPlane, FrameArena& frame) {
+        this->view = view;
+        this->farPlane = farPlane;
+        this->frame = &frame;
+        calls = NULL;
+        items = scratch = NULL;
+        count = capacity = 0;
+        grow(RENDER_QUEUE_INITIAL_DRAWS);
+    }
+
+    void submit(RenderPass pass, const DrawCall& draw) {
+        glm::vec4 center = view * draw.model * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        float distance = glm::clamp(-center.z / farPlane, 0.0f, 1.0f);
+        uint64_t depth = (uint64_t)(distance * 0xFFFFFF);
+
+        uint64_t state = ((uint64_t)(draw.shader->ID & 0x3FF) << 28)
+                       | (material_key(draw.material) << 16)
+                       | (uint64_t)(draw.VAO & 0xFFFF);
+        uint64_t key = (uint64_t)pass << 62;
+        if (pass == PASS_OPAQUE) key |= state << 24 | depth;
+        else key |= (0xFFFFFF - depth) << 38 | state;
+
+        if (count == capacity && !grow(capacity * 2)) execute();
+        if (count == capacity) return;      // not even the first list fit
+        SortItem item = { key, (unsigned int)count };
+        items[count] = item;
+        calls[count] = draw;
+        count++;
+    }
+
+    // sort and draw everything submitted since begin(); the queue is empty afterwards
+    void execute() {
+        radix_sort(items, scratch, count);
+
+        draws = shaderChanges = materialChanges = vaoChanges = 0;
+        ShaderProgram* shader = NULL;
+        const Material* material = NULL;
+        unsigned int VAO = 0xFFFFFFFFu;
+        float lodFade = 0.0f;
+        bool transparent = false;
+
+        for (size_t i = 0; i < count; i++) {
+            const DrawCall& draw = calls[items[i].index];
+            if (!transparent && (items[i].key >> 62) == PASS_TRANSPARENT) {
+                // blended over the opaque result, depth tested but not written
+                gl_state().enable(GL_BLEND);
+                gl_state().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                gl_state().depthMask(GL_FALSE);
+                transparent = true;
+            }
+            if (draw.shader != shader) {
+                shader = draw.shader;
+                shader->use();
+                material = NULL;            // material uniforms are per program
+                shader->setFloat("lodFade", draw.lodFade);
+                lodFade = draw.lodFade;
+                shaderChanges++;
+            }
+            else if (draw.lodFade != lodFade) {
+                shader->setFloat("lodFade", draw.lodFade);
+                lodFade = draw.lodFade;
+            }
+            if (draw.material != NULL && !same_material(draw.material, material)) {
+                set_material(shader, *draw.material);
+                material = draw.material;
+                materialChanges++;
+            }
+            if (draw.VAO != VAO) {
+                gl_state().bindVertexArray(draw.VAO);
+                VAO = draw.VAO;
+                vaoChanges++;
+            }
+
+            shader->setMat4("model", draw.model);
+            if (draw.indexType != 0)
+                glDrawElementsBaseVertex(draw.mode, draw.count, draw.indexType, (void*)draw.indexOffset, draw.baseVertex);
+            else glDrawArrays(draw.mode, 0, draw.count);
+            draws++;
+        }
+
+        if (transparent) {
+            gl_state().depthMask(GL_TRUE);
+            gl_state().disable(GL_BLEND);
+        }
+        count = 0;
+    }
+
+private:
+    glm::mat4 view = glm::mat4(1.0f);
+    float farPlane = 100.0f;
+    FrameArena* frame = NULL;
+    DrawCall* calls = NULL;
+    SortItem* items = NULL;
+    SortItem* scratch = NULL;
+    size_t count = 0, capacity = 0;
+
+    // moves the list into larger arrays from the frame arena; the old ones stay there until the reset
+    bool grow(size_t newCapacity) {
+        if (frame == NULL) return false;
+        DrawCall* newCalls = frame->allocate<DrawCall>(newCapacity);
+        SortItem* newItems = frame->allocate<SortItem>(newCapacity);
+        SortItem* newScratch = frame->allocate<SortItem>(newCapacity);
+        if (newCalls == NULL || newItems == NULL || newScratch == NULL) return false;
+        if (count > 0) {
+            memcpy(newCalls, calls, count * sizeof(DrawCall));
+            memcpy(newItems, items, count * sizeof(SortItem));
+        }
+        calls = newCalls;
+        items = newItems;
+        scratch = newScratch;
+        capacity = newCapacity;
+        return true;
+    }
+
+    static bool same_material(const Material* a, const Material* b) {
+        return b != NULL && a->diffuseLayer == b->diffuseLayer && a->specularLayer == b->specularLayer
+            && a->shininess == b->shininess;
+    }
+
+    RenderQueue(const RenderQueue&);
+    RenderQueue& operator=(const RenderQueue&);
+};
+
+#endif
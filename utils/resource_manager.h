@@ -0,0 +1,341 @@
+#ifndef RESOURCE_MANAGER_H
+#define RESOURCE_MANAGER_H
+
+// Handle-based resource lifetime.
+//      ResourceManager resources;
+//      Pool<Cylinder> cylinders(16);                          // storage for 16, allocated once
+//      Handle<Cylinder> h = cylinders.create(48, arena);       // constructed in place
+//      cylinders.get(h)->draw(shader);                         // NULL once h is stale
+//      resources.destroy(cylinders, h);                        // destructor runs when the GPU is done
+//
+//      GLuint vbo = gl_names().buffer();                       // names come from batched glGen* calls
+//      DrawCall* draws = resources.frame().allocate<DrawCall>(n);  // valid until endFrame()
+//      ...
+//      glfwSwapBuffers(window);
+//      resources.endFrame();
+//
+// A handle is a slot index and the slot's generation. Destroying an object bumps the
+// generation, so every old handle to the slot stops resolving instead of pointing at
+// whatever is created there next.
+//
+// destroy() only queues the object with the current frame number. endFrame() fences
+// the frame and destroys the queued objects of every frame whose fence has signalled.
+// A mesh that draws of frames still in flight read is never released under them.
+//
+// gl_names() hands out buffer, texture, VAO and framebuffer names from one glGen* call
+// per RESOURCE_NAME_BATCH names (DynamicBuffer and GeometryArena take theirs from it).
+// Names are still deleted one object at a time through gl_state().
+//
+// Pools and the frame arena allocate their storage once. The frame loop allocates
+// nothing as long as the pools and the arena are sized for it; the render queue's
+// per-frame draw list lives in the frame arena.
+
+#include <GL/glew.h>
+#include <gl_state.h>
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <iostream>
+#include <cstdint>
+
+#define RESOURCE_NAME_BATCH 32
+
+template <typename T>
+struct Handle {
+    uint32_t index = 0;
+    uint32_t generation = 0;                // 0: never valid
+
+    bool valid() const { return generation != 0; }
+    bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+// fixed capacity, objects constructed in place, free slots reused last-in first-out
+template <typename T>
+class Pool {
+public:
+    uint32_t capacity;
+
+    explicit Pool(uint32_t capacity) : capacity(capacity), storage(capacity), generations(capacity, 1), alive(capacity, 0) {
+        freeSlots.reserve(capacity);
+        for (uint32_t i = capacity; i > 0; i--) freeSlots.push_back(i - 1);
+        MEMORY_TRACK_HOST(this, capacity * (sizeof(Slot) + 2 * sizeof(uint32_t) + 1), "resource pool");
+    }
+
+    ~Pool() {
+        for (uint32_t i = 0; i < capacity; i++)
+            if (alive[i]) object(i)->~T();
+        MEMORY_RELEASE_HOST(this);
+    }
+
+    // invalid handle when the pool is full
+    template <typename... Args> Handle<T> create(Args&&... args) {
+        Handle<T> handle;
+        if (freeSlots.empty()) {
+            if (!overflowReported) std::cout << "RESOURCES: pool of " << capacity << " is full" << std::endl;
+            overflowReported = true;
+            return handle;
+        }
+        handle.index = freeSlots.back();
+        freeSlots.pop_back();
+        new (&storage[handle.index]) T(std::forward<Args>(args)...);
+        alive[handle.index] = 1;
+        handle.generation = generations[handle.index];
+        return handle;
+    }
+
+    T* get(Handle<T> handle) const {
+        if (handle.index >= capacity || !alive[handle.index] || generations[handle.index] != handle.generation) return NULL;
+        return object(handle.index);
+    }
+
+    // immediate; ResourceManager::destroy() defers it until the GPU is done with the object.
+    // false when the handle was already stale
+    bool destroy(Handle<T> handle) {
+        T* target = get(handle);
+        if (target == NULL) return false;
+        target->~T();
+        alive[handle.index] = 0;
+        if (++generations[handle.index] == 0) generations[handle.index] = 1;
+        freeSlots.push_back(handle.index);
+        return true;
+    }
+
+    uint32_t live() const {
+        return capacity - (uint32_t)freeSlots.size();
+    }
+
+private:
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+    std::vector<Slot> storage;
+    std::vector<uint32_t> generations;
+    std::vector<unsigned char> alive;
+    std::vector<uint32_t> freeSlots;
+    bool overflowReported = false;
+
+    T* object(uint32_t index) const {
+        return (T*)&storage[index];
+    }
+
+    Pool(const Pool&);
+    Pool& operator=(const Pool&);
+};
+
+// bump allocator for data that lives until the end of the frame; no destructors run
+class FrameArena {
+public:
+    size_t capacity;
+    size_t peak = 0;                        // most bytes used by one frame
+
+    explicit FrameArena(size_t capacity) : capacity(capacity), memory(capacity) {
+        MEMORY_TRACK_HOST(this, capacity, "frame arena");
+    }
+
+    ~FrameArena() {
+        MEMORY_RELEASE_HOST(this);
+    }
+
+    // NULL when the frame's arena is exhausted
+    void* allocate(size_t bytes, size_t alignment = 16) {
+        size_t start = (head + alignment - 1) / alignment * alignment;
+        if (start + bytes > capacity) {
+            if (!overflowReported) std::cout << "RESOURCES: " << bytes << " bytes do not fit the " << capacity
+                                             << " byte frame arena" << std::endl;
+            overflowReported = true;
+            return NULL;
+        }
+        head = start + bytes;
+        return memory.data() + start;
+    }
+
+    template <typename T> T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "frame arena objects are never destroyed");
+        return (T*)allocate(count * sizeof(T), alignof(T));
+    }
+
+    size_t used() const {
+        return head;
+    }
+
+    void reset() {
+        if (head > peak) peak = head;
+        head = 0;
+    }
+
+private:
+    std::vector<unsigned char> memory;
+    size_t head = 0;
+    bool overflowReported = false;
+
+    FrameArena(const FrameArena&);
+    FrameArena& operator=(const FrameArena&);
+};
+
+// GL names generated RESOURCE_NAME_BATCH at a time. Names belong to the context that
+// generated them: main thread only.
+class GLNameBatch {
+public:
+    // statistics, cumulative
+    unsigned int genCalls = 0, namesHandedOut = 0;
+
+    GLuint buffer() { return acquire(NAME_BUFFER); }
+    GLuint texture() { return acquire(NAME_TEXTURE); }
+    GLuint vertexArray() { return acquire(NAME_VERTEX_ARRAY); }
+    GLuint framebuffer() { return acquire(NAME_FRAMEBUFFER); }
+
+    // returns the names never handed out; before the context is destroyed
+    void release() {
+        for (int kind = 0; kind < NAME_KINDS; kind++) {
+            std::vector<GLuint>& names = spare[kind];
+            if (names.empty()) continue;
+            GLsizei count = (GLsizei)names.size();
+            switch (kind) {
+            case NAME_BUFFER: glDeleteBuffers(count, names.data()); break;
+            case NAME_TEXTURE: glDeleteTextures(count, names.data()); break;
+            case NAME_VERTEX_ARRAY: glDeleteVertexArrays(count, names.data()); break;
+            case NAME_FRAMEBUFFER: glDeleteFramebuffers(count, names.data()); break;
+            }
+            names.clear();
+        }
+    }
+
+private:
+    enum NameKind {
+        NAME_BUFFER = 0,
+        NAME_TEXTURE = 1,
+        NAME_VERTEX_ARRAY = 2,
+        NAME_FRAMEBUFFER = 3,
+        NAME_KINDS = 4
+    };
+
+    std::vector<GLuint> spare[NAME_KINDS];  // generated, not handed out yet
+
+    GLuint acquire(int kind) {
+        std::vector<GLuint>& names = spare[kind];
+        if (names.empty()) {
+            names.resize(RESOURCE_NAME_BATCH);
+            switch (kind) {
+            case NAME_BUFFER: glGenBuffers(RESOURCE_NAME_BATCH, names.data()); break;
+            case NAME_TEXTURE: glGenTextures(RESOURCE_NAME_BATCH, names.data()); break;
+            case NAME_VERTEX_ARRAY: glGenVertexArrays(RESOURCE_NAME_BATCH, names.data()); break;
+            case NAME_FRAMEBUFFER: glGenFramebuffers(RESOURCE_NAME_BATCH, names.data()); break;
+            }
+            genCalls++;
+        }
+        GLuint name = names.back();
+        names.pop_back();
+        namesHandedOut++;
+        return name;
+    }
+};
+
+inline GLNameBatch& gl_names() {
+    static GLNameBatch names;
+    return names;
+}
+
+class ResourceManager {
+public:
+    unsigned int objectsDestroyed = 0;      // cumulative, stale handles not counted
+
+    explicit ResourceManager(size_t frameArenaBytes = 1 << 20) : arena(frameArenaBytes) {
+        retired.reserve(256);
+    }
+
+    // waits for the GPU and releases everything still queued; the GL context must
+    // still be current and the pools of queued objects still alive
+    ~ResourceManager() {
+        glFinish();
+        for (size_t i = 0; i < fences.size(); i++) glDeleteSync(fences[i].fence);
+        fences.clear();
+        retire(frameNumber);
+    }
+
+    // the object is destroyed once every frame submitted so far has finished on the GPU
+    template <typename T> void destroy(Pool<T>& pool, Handle<T> handle) {
+        if (pool.get(handle) == NULL) return;
+        Retired entry;
+        entry.frame = frameNumber;
+        entry.pool = &pool;
+        entry.destroy = &destroyInPool<T>;
+        entry.index = handle.index;
+        entry.generation = handle.generation;
+        retired.push_back(entry);
+    }
+
+    // per-frame temporaries; everything allocated is reclaimed by endFrame()
+    FrameArena& frame() {
+        return arena;
+    }
+
+    // after the frame's last GL call (after glfwSwapBuffers)
+    void endFrame() {
+        FrameFence entry;
+        entry.frame = frameNumber;
+        entry.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        fences.push_back(entry);
+        frameNumber++;
+
+        // frames complete in order: stop at the first fence still pending
+        size_t done = 0;
+        while (done < fences.size() && glClientWaitSync(fences[done].fence, 0, 0) != GL_TIMEOUT_EXPIRED) done++;
+        if (done > 0) {
+            unsigned int completed = fences[done - 1].frame;
+            for (size_t i = 0; i < done; i++) glDeleteSync(fences[i].fence);
+            fences.erase(fences.begin(), fences.begin() + done);
+            retire(completed);
+        }
+        arena.reset();
+    }
+
+    // queued destructions waiting for the GPU
+    size_t pending() const {
+        return retired.size();
+    }
+
+private:
+    struct Retired {
+        unsigned int frame;
+        void* pool;
+        bool (*destroy)(void* pool, uint32_t index, uint32_t generation);
+        uint32_t index, generation;
+    };
+
+    struct FrameFence {
+        unsigned int frame;
+        GLsync fence;
+    };
+
+    FrameArena arena;
+    unsigned int frameNumber = 0;
+    std::vector<Retired> retired;
+    std::vector<FrameFence> fences;
+
+    template <typename T> static bool destroyInPool(void* pool, uint32_t index, uint32_t generation) {
+        Handle<T> handle;
+        handle.index = index;
+        handle.generation = generation;
+        return ((Pool<T>*)pool)->destroy(handle);
+    }
+
+    // entries queued up to and including `completed`, in queue order
+    void retire(unsigned int completed) {
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); i++) {
+            const Retired& entry = retired[i];
+            if (entry.frame > completed) {
+                retired[kept++] = entry;
+                continue;
+            }
+            // the same handle may be queued twice; only the first destroy counts
+            if (entry.destroy(entry.pool, entry.index, entry.generation)) objectsDestroyed++;
+        }
+        retired.resize(kept);
+    }
+
+    ResourceManager(const ResourceManager&);
+    ResourceManager& operator=(const ResourceManager&);
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+// Stream buffer for data the CPU rewrites every frame (dynamic vertices, uniform
+// blocks, instance data). One GL buffer holds RING_BUFFER_FRAMES regions; each
+// frame writes into its own region, which the GPU reads while the CPU moves on to
+// the next one. A fence per region makes the CPU wait only when it gets
+// RING_BUFFER_FRAMES frames ahead; no write ever synchronizes implicitly.
+//      RingBuffer ring(GL_ARRAY_BUFFER, 4096);               // bytes per frame
+//      GLintptr offset;
+//      float* v = (float*)ring.map(bytes, offset, 2 * sizeof(float));
+//      ... write ...
+//      ring.unmap();
+//      glDrawArrays(GL_LINES, (GLint)(offset / (2 * sizeof(float))), 2);    // VAO points at offset 0
+//      ...
+//      glfwSwapBuffers(window);
+//      ring.endFrame();
+// Uniform blocks: map(size, offset, uniformAlignment()) and glBindBufferRange(ID, offset, size).
+//
+// GL_ARB_buffer_storage: the buffer is mapped once, persistent and coherent, so map()
+// is pointer arithmetic and unmap() does nothing. Otherwise map() maps the range
+// unsynchronized; that is safe for the same reason: the fence already guarantees
+// the GPU is done with the region.
+//
+// Data lives for one frame: anything drawn every frame is written every frame.
+
+#include <GL/glew.h>
+#include <gl_state.h>
+#include <iostream>
+
+#define RING_BUFFER_FRAMES 3
+
+class RingBuffer {
+public:
+    GLenum target;
+    unsigned int ID = 0;
+    size_t regionSize;                      // bytes available to one frame
+    bool persistent = false;
+
+    // statistics
+    unsigned int frames = 0, waits = 0;     // waits: the GPU was RING_BUFFER_FRAMES frames behind
+    size_t bytesWritten = 0;
+
+    RingBuffer(GLenum target, size_t regionSize) {
+        this->target = target;
+        this->regionSize = regionSize;
+        persistent = GLEW_ARB_buffer_storage != 0;
+        for (int i = 0; i < RING_BUFFER_FRAMES; i++) fences[i] = 0;
+
+        glGenBuffers(1, &ID);
+        gl_state().bindBuffer(target, ID);
+        GLsizeiptr total = (GLsizeiptr)(regionSize * RING_BUFFER_FRAMES);
+        if (persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(target, total, NULL, flags);
+            base = (unsigned char*)glMapBufferRange(target, 0, total, flags);
+        }
+        else glBufferData(target, total, NULL, GL_STREAM_DRAW);
+        MEMORY_TRACK_BUFFER(ID, (size_t)total, buffer_category(target), "ring buffer");
+    }
+
+    ~RingBuffer() {
+        for (int i = 0; i < RING_BUFFER_FRAMES; i++)
+            if (fences[i] != 0) glDeleteSync(fences[i]);
+        if (persistent) {
+            gl_state().bindBuffer(target, ID);
+            glUnmapBuffer(target);
+        }
+        gl_state().deleteBuffers(1, &ID);
+    }
+
+    // bytes of this frame's region, aligned; offset is relative to the buffer start.
+    // NULL when the region is full (regionSize is too small for one frame's data)
+    // or GL could not map the range; nothing needs unmapping then
+    void* map(size_t bytes, GLintptr& offset, size_t alignment = 4) {
+        if (!regionReady) waitRegion();
+
+        size_t start = (head + alignment - 1) / alignment * alignment;
+        if (start + bytes > regionSize) {
+            if (!overflowReported) std::cout << "RING: " << bytes << " bytes do not fit the " << regionSize
+                                             << " byte frame region" << std::endl;
+            overflowReported = true;
+            return NULL;
+        }
+        head = start + bytes;
+        offset = (GLintptr)(region * regionSize + start);
+        bytesWritten += bytes;
+
+        if (persistent) return base + offset;
+        gl_state().bindBuffer(target, ID);
+        void* pointer = glMapBufferRange(target, offset, (GLsizeiptr)bytes, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+                                         | GL_MAP_INVALIDATE_RANGE_BIT);
+        mapped = pointer != NULL;
+        return pointer;
+    }
+
+    // before the draw that reads the data
+    void unmap() {
+        if (!mapped) return;
+        gl_state().bindBuffer(target, ID);
+        glUnmapBuffer(target);
+        mapped = false;
+    }
+
+    // after the frame's last draw: fence the region and move to the next one
+    void endFrame() {
+        if (fences[region] != 0) glDeleteSync(fences[region]);
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region = (region + 1) % RING_BUFFER_FRAMES;
+        head = 0;
+        regionReady = false;
+        frames++;
+    }
+
+    static GLint uniformAlignment() {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        return alignment;
+    }
+
+private:
+    unsigned char* base = NULL;             // persistent mapping
+    GLsync fences[RING_BUFFER_FRAMES];
+    int region = 0;
+    size_t head = 0;                        // bytes used in the current region
+    bool regionReady = true;                // the current region's fence has been waited for
+    bool mapped = false;
+    bool overflowReported = false;
+
+    // the GPU reads the region written RING_BUFFER_FRAMES frames ago until its fence signals
+    void waitRegion() {
+        regionReady = true;
+        if (fences[region] == 0) return;
+        GLenum result = glClientWaitSync(fences[region], 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            waits++;
+            while (result == GL_TIMEOUT_EXPIRED)
+                result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        glDeleteSync(fences[region]);
+        fences[region] = 0;
+    }
+
+    RingBuffer(const RingBuffer&);
+    RingBuffer& operator=(const RingBuffer&);
+};
+
+#endif
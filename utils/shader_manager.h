@@ -0,0 +1,418 @@
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+// Parallel, non-blocking shader compilation.
+//      ShaderManager shaders(window);
+//      ShaderProgram* lit = shaders.submit("a.vs", "a.fs", onReady);   // returns at once
+//      ...
+//      shaders.poll();                 // once per frame, never blocks
+//      if (lit->ready()) { lit->use(); ... }
+//
+// Every program is submitted up front, so startup costs the longest compile
+// instead of the sum of all of them.
+//      GL_KHR/ARB_parallel_shader_compile: the driver compiles on its own threads;
+//          poll() asks GL_COMPLETION_STATUS instead of the blocking COMPILE/LINK_STATUS
+//      otherwise: a worker thread with a hidden shared context compiles and links,
+//          a fence tells the main context when the program can be used
+//      no shared context either: poll() compiles one program per call on the main thread
+//
+// ShaderProgram has the same setters as Shader (shader.h).
+// submitCompute() queues a compute program (one GL_COMPUTE_SHADER stage) the same way.
+// submitFeedback() queues a vertex-only program whose outputs are captured by
+// transform feedback; the varyings are declared before the link.
+// A source line `#include "file"` is replaced by that file, read relative to the
+// including one, so code several programs must agree on lives in one place.
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <gl_state.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+class ShaderProgram {
+public:
+    unsigned int ID = 0;
+    std::string name;                       // "<vertex path> + <fragment path>"
+    double compileTime = 0.0;               // seconds from submit() to ready
+    std::function<void(ShaderProgram*)> onReady;
+
+    bool ready() const { return state == READY; }
+    bool failed() const { return state == FAILED; }
+
+    void use() const {
+        gl_state().useProgram(ID);
+    }
+    void setBool(const std::string& name, bool value) const {
+        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    }
+    void setInt(const std::string& name, int value) const {
+        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    }
+    void setFloat(const std::string& name, float value) const {
+        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    }
+    void setVec2(const std::string& name, const glm::vec2& value) const {
+        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+    }
+    void setVec2(const std::string& name, float x, float y) const {
+        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    }
+    void setVec3(const std::string& name, const glm::vec3& value) const {
+        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+    }
+    void setVec3(const std::string& name, float x, float y, float z) const {
+        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    }
+    void setVec4(const std::string& name, const glm::vec4& value) const {
+        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+    }
+    void setVec4(const std::string& name, float x, float y, float z, float w) const {
+        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    }
+    void setMat3(const std::string& name, const glm::mat3& mat) const {
+        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+    }
+    void setMat4(const std::string& name, const glm::mat4& mat) const {
+        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+    }
+
+private:
+    friend class ShaderManager;
+    enum State { PENDING, READY, FAILED };
+
+    State state = PENDING;
+    bool compute = false;                   // vertexSource/vertexID then hold the compute stage
+    std::string vertexSource, fragmentSource;   // no fragment source: vertex stage only
+    std::vector<std::string> feedbackVaryings;  // captured interleaved
+    unsigned int vertexID = 0, fragmentID = 0;
+    double submitTime = 0.0;
+
+    // worker thread path
+    std::atomic<bool> built{ false };
+    bool buildFailed = false;
+    GLsync fence = 0;
+};
+
+class ShaderManager {
+public:
+    enum Mode { DRIVER_PARALLEL, WORKER_CONTEXT, MAIN_THREAD };
+    Mode mode;
+
+    // call after glewInit() with the window whose context renders
+    ShaderManager(GLFWwindow* window) {
+        startTime = glfwGetTime();
+        if (GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile) {
+            // let the driver pick as many compiler threads as it likes
+            if (GLEW_KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            else glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+            mode = DRIVER_PARALLEL;
+        }
+        else {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            workerWindow = glfwCreateWindow(1, 1, "shader compiler", NULL, window);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+            if (workerWindow != NULL) {
+                mode = WORKER_CONTEXT;
+                worker = std::thread(&ShaderManager::workerLoop, this);
+            }
+            else mode = MAIN_THREAD;
+        }
+        std::cout << "SHADER: compiling with " << modeName() << std::endl;
+    }
+
+    ~ShaderManager() {
+        if (worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            worker.join();
+        }
+        if (workerWindow != NULL) glfwDestroyWindow(workerWindow);
+        for (size_t i = 0; i < programs.size(); i++) {
+            if (programs[i]->ID != 0) gl_state().deleteProgram(programs[i]->ID);
+            delete programs[i];
+        }
+    }
+
+    // queue a program and return immediately; onReady runs on the main thread inside poll()
+    ShaderProgram* submit(const char* vertexPath, const char* fragmentPath,
+                          std::function<void(ShaderProgram*)> onReady = nullptr) {
+        ShaderProgram* program = create(std::string(vertexPath) + " + " + fragmentPath, onReady);
+        if (!readFile(vertexPath, program->vertexSource) || !readFile(fragmentPath, program->fragmentSource)) {
+            program->state = ShaderProgram::FAILED;
+            pending--;
+            return program;
+        }
+        schedule(program);
+        return program;
+    }
+
+    ShaderProgram* submitCompute(const char* computePath, std::function<void(ShaderProgram*)> onReady = nullptr) {
+        ShaderProgram* program = create(computePath, onReady);
+        program->compute = true;
+        if (!readFile(computePath, program->vertexSource)) {
+            program->state = ShaderProgram::FAILED;
+            pending--;
+            return program;
+        }
+        schedule(program);
+        return program;
+    }
+
+    // vertex stage only, its outputs `varyings` captured interleaved by transform feedback
+    ShaderProgram* submitFeedback(const char* vertexPath, const std::vector<std::string>& varyings,
+                                  std::function<void(ShaderProgram*)> onReady = nullptr) {
+        ShaderProgram* program = create(vertexPath, onReady);
+        program->feedbackVaryings = varyings;
+        if (!readFile(vertexPath, program->vertexSource)) {
+            program->state = ShaderProgram::FAILED;
+            pending--;
+            return program;
+        }
+        schedule(program);
+        return program;
+    }
+
+    // finish every program whose compile completed; returns how many are still pending
+    int poll() {
+        if (mode == MAIN_THREAD && !mainQueue.empty()) {
+            // one blocking build per frame so rendering keeps going
+            ShaderProgram* program = mainQueue.front();
+            mainQueue.pop_front();
+            program->buildFailed = !build(program);
+            program->built = true;
+        }
+
+        for (size_t i = 0; i < programs.size(); i++) {
+            ShaderProgram* program = programs[i];
+            if (program->state != ShaderProgram::PENDING) continue;
+
+            bool ok;
+            if (mode == DRIVER_PARALLEL) {
+                GLint done = GL_FALSE;
+                glGetProgramiv(program->ID, GL_COMPLETION_STATUS_KHR, &done);
+                if (!done) continue;
+                // completed: the status queries no longer block
+                ok = checkBuild(program);
+            }
+            else {
+                if (!program->built) continue;
+                if (program->fence != 0) {
+                    GLenum status = glClientWaitSync(program->fence, 0, 0);
+                    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+                    glDeleteSync(program->fence);
+                    program->fence = 0;
+                }
+                ok = !program->buildFailed;
+            }
+            finish(program, ok);
+        }
+        return pending;
+    }
+
+    bool allReady() const {
+        return pending == 0;
+    }
+
+    const char* modeName() const {
+        switch (mode) {
+        case DRIVER_PARALLEL: return "driver parallel compile";
+        case WORKER_CONTEXT: return "worker thread context";
+        default: return "main thread, one program per frame";
+        }
+    }
+
+private:
+    std::vector<ShaderProgram*> programs;
+    int pending = 0;
+    double startTime;
+
+    // WORKER_CONTEXT
+    GLFWwindow* workerWindow = NULL;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<ShaderProgram*> queue;
+    bool stopping = false;
+
+    // MAIN_THREAD
+    std::deque<ShaderProgram*> mainQueue;
+
+    ShaderProgram* create(const std::string& name, std::function<void(ShaderProgram*)> onReady) {
+        ShaderProgram* program = new ShaderProgram();
+        program->name = name;
+        program->onReady = onReady;
+        program->submitTime = glfwGetTime();
+        programs.push_back(program);
+        pending++;
+        return program;
+    }
+
+    void schedule(ShaderProgram* program) {
+        if (mode == DRIVER_PARALLEL) {
+            // compile and link are only kicked off; nothing here waits for the driver
+            startBuild(program);
+        }
+        else if (mode == WORKER_CONTEXT) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(program);
+            }
+            wake.notify_one();
+        }
+        else mainQueue.push_back(program);
+    }
+
+    void workerLoop() {
+        glfwMakeContextCurrent(workerWindow);
+        for (;;) {
+            ShaderProgram* program;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) break;
+                program = queue.front();
+                queue.pop_front();
+            }
+            program->buildFailed = !build(program);
+            // the main context may use the program once this fence has passed
+            program->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+            program->built = true;
+        }
+        glfwMakeContextCurrent(NULL);
+    }
+
+    // blocking compile + link in the current context
+    bool build(ShaderProgram* program) {
+        startBuild(program);
+        return checkBuild(program);
+    }
+
+    void startBuild(ShaderProgram* program) {
+        program->ID = glCreateProgram();
+        if (program->compute) {
+            program->vertexID = createStage(GL_COMPUTE_SHADER, program->vertexSource);
+        }
+        else {
+            program->vertexID = createStage(GL_VERTEX_SHADER, program->vertexSource);
+            if (!program->fragmentSource.empty()) {
+                program->fragmentID = createStage(GL_FRAGMENT_SHADER, program->fragmentSource);
+                glAttachShader(program->ID, program->fragmentID);
+            }
+        }
+        glAttachShader(program->ID, program->vertexID);
+        if (!program->feedbackVaryings.empty()) {
+            std::vector<const char*> varyings;
+            for (size_t i = 0; i < program->feedbackVaryings.size(); i++) varyings.push_back(program->feedbackVaryings[i].c_str());
+            glTransformFeedbackVaryings(program->ID, (GLsizei)varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+        }
+        glLinkProgram(program->ID);
+    }
+
+    // status of a started build; blocks unless the driver reported completion
+    bool checkBuild(ShaderProgram* program) {
+        bool ok = checkStage(program, program->vertexID, program->compute ? "compute" : "vertex") &&
+                  (program->fragmentID == 0 || checkStage(program, program->fragmentID, "fragment")) &&
+                  checkLink(program);
+        glDeleteShader(program->vertexID);
+        if (program->fragmentID != 0) glDeleteShader(program->fragmentID);
+        return ok;
+    }
+
+    void finish(ShaderProgram* program, bool ok) {
+        program->state = ok ? ShaderProgram::READY : ShaderProgram::FAILED;
+        program->compileTime = glfwGetTime() - program->submitTime;
+        pending--;
+        if (ok) {
+            std::cout << "SHADER: " << program->name << " ready after " << program->compileTime * 1000.0 << " ms" << std::endl;
+            if (program->onReady) program->onReady(program);
+        }
+        if (pending == 0)
+            std::cout << "SHADER: all " << programs.size() << " programs done after "
+                      << (glfwGetTime() - startTime) * 1000.0 << " ms" << std::endl;
+    }
+
+    // the file with its #include lines expanded
+    static bool readFile(const char* path, std::string& source, int depth = 0) {
+        std::ifstream file(path);
+        if (!file) {
+            std::cout << "SHADER: cannot read " << path << std::endl;
+            return false;
+        }
+        std::string directory(path);
+        size_t slash = directory.find_last_of("/\\");
+        directory = slash == std::string::npos ? std::string() : directory.substr(0, slash + 1);
+
+        std::stringstream stream;
+        std::string line;
+        while (std::getline(file, line)) {
+            size_t open = line.find('"');
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (line.compare(0, 8, "#include") != 0 || close == std::string::npos) {
+                stream << line << '\n';
+                continue;
+            }
+            std::string included;
+            std::string includePath = directory + line.substr(open + 1, close - open - 1);
+            if (depth >= 8) {
+                std::cout << "SHADER: " << path << " includes too deeply" << std::endl;
+                return false;
+            }
+            if (!readFile(includePath.c_str(), included, depth + 1)) return false;
+            stream << included;
+        }
+        source = stream.str();
+        return true;
+    }
+
+    static unsigned int createStage(GLenum type, const std::string& source) {
+        unsigned int shader = glCreateShader(type);
+        const char* code = source.c_str();
+        glShaderSource(shader, 1, &code, NULL);
+        glCompileShader(shader);
+        return shader;
+    }
+
+    static bool checkStage(ShaderProgram* program, unsigned int shader, const char* type) {
+        GLint success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (success) return true;
+        char infoLog[1024];
+        glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+        std::cout << "SHADER: " << program->name << " " << type << " compile error\n" << infoLog << std::endl;
+        return false;
+    }
+
+    static bool checkLink(ShaderProgram* program) {
+        GLint success;
+        glGetProgramiv(program->ID, GL_LINK_STATUS, &success);
+        if (success) return true;
+        char infoLog[1024];
+        glGetProgramInfoLog(program->ID, sizeof(infoLog), NULL, infoLog);
+        std::cout << "SHADER: " << program->name << " link error\n" << infoLog << std::endl;
+        return false;
+    }
+
+    ShaderManager(const ShaderManager&);
+    ShaderManager& operator=(const ShaderManager&);
+};
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+// Compile-time vertex formats.
+//      typedef VertexFormat<Position3f, Normal3f, TexCoord2f> Format;
+//
+//      Format::Vertex     : packed vertex holding exactly the listed attributes
+//      Format::setup()    : glVertexAttribPointer/glEnableVertexAttribArray for every attribute
+//      Format::verify(ID) : compare the format with the active attributes of a linked program
+//
+// Attribute locations follow the homework shaders:
+//      0 aPos, 1 aNormal, 2 aColor, 3 aTexCoord(s)
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <cstring>
+
+// one vertex attribute: shader location, CPU storage type and GL description.
+// ShaderComponents is the size of the GLSL input, smaller than Components when
+// the data carries padding (e.g. a packed 10:10:10:2 normal read as vec3).
+template <GLuint Location, typename Storage, GLenum Type, GLint Components, GLboolean Normalized = GL_FALSE, GLint ShaderComponents = Components>
+struct Attrib {
+    typedef Storage storage;
+    static const GLuint location = Location;
+    static const GLenum type = Type;
+    static const GLint components = Components;
+    static const GLboolean normalized = Normalized;
+    static const GLint shaderComponents = ShaderComponents;
+    static const size_t size = sizeof(Storage);
+};
+
+typedef Attrib<0, glm::vec3, GL_FLOAT, 3> Position3f;
+typedef Attrib<1, glm::vec3, GL_FLOAT, 3> Normal3f;
+typedef Attrib<2, glm::vec3, GL_FLOAT, 3> Color3f;
+typedef Attrib<2, glm::vec4, GL_FLOAT, 4> Color4f;
+typedef Attrib<3, glm::vec2, GL_FLOAT, 2> TexCoord2f;
+
+
+// sum of the attribute sizes
+template <typename... Attrs> struct AttribSize;
+template <> struct AttribSize<> {
+    static const size_t value = 0;
+};
+template <typename A, typename... Rest> struct AttribSize<A, Rest...> {
+    static const size_t value = A::size + AttribSize<Rest...>::value;
+};
+
+// byte offset of Target in a packed vertex of Attrs
+template <typename Target, typename... Attrs> struct AttribOffset;
+template <typename Target> struct AttribOffset<Target> {
+    static_assert(sizeof(Target) == 0, "attribute is not part of the vertex format");
+};
+template <typename Target, typename... Rest> struct AttribOffset<Target, Target, Rest...> {
+    static const size_t value = 0;
+};
+template <typename Target, typename A, typename... Rest> struct AttribOffset<Target, A, Rest...> {
+    static const size_t value = A::size + AttribOffset<Target, Rest...>::value;
+};
+
+// true when no attribute of Attrs uses `Location`
+template <GLuint Location, typename... Attrs> struct LocationFree;
+template <GLuint Location> struct LocationFree<Location> {
+    static const bool value = true;
+};
+template <GLuint Location, typename A, typename... Rest> struct LocationFree<Location, A, Rest...> {
+    static const bool value = A::location != Location && LocationFree<Location, Rest...>::value;
+};
+
+// true when no two attributes share a location
+template <typename... Attrs> struct AttribUnique;
+template <> struct AttribUnique<> {
+    static const bool value = true;
+};
+template <typename A, typename... Rest> struct AttribUnique<A, Rest...> {
+    static const bool value = LocationFree<A::location, Rest...>::value && AttribUnique<Rest...>::value;
+};
+
+// true when the format contains an attribute at `location`
+template <typename... Attrs> struct AttribAt;
+template <> struct AttribAt<> {
+    static bool find(GLuint location, GLint& components, size_t& size) { return false; }
+};
+template <typename A, typename... Rest> struct AttribAt<A, Rest...> {
+    static bool find(GLuint location, GLint& components, size_t& size) {
+        if (A::location == location) {
+            components = A::shaderComponents;
+            size = A::size;
+            return true;
+        }
+        return AttribAt<Rest...>::find(location, components, size);
+    }
+};
+
+
+template <typename... Attrs>
+class VertexFormat {
+public:
+    static_assert(AttribUnique<Attrs...>::value, "two attributes share a shader location");
+
+    static const size_t stride = AttribSize<Attrs...>::value;
+
+    struct Vertex {
+        unsigned char bytes[stride];
+
+        template <typename A> void set(const typename A::storage& value) {
+            memcpy(bytes + AttribOffset<A, Attrs...>::value, &value, A::size);
+        }
+
+        template <typename A> typename A::storage get() const {
+            typename A::storage value;
+            memcpy(&value, bytes + AttribOffset<A, Attrs...>::value, A::size);
+            return value;
+        }
+    };
+    static_assert(sizeof(Vertex) == stride, "vertex is not tightly packed");
+
+    template <typename A> static size_t offset() {
+        return AttribOffset<A, Attrs...>::value;
+    }
+
+    // attribute pointers for the bound VAO and GL_ARRAY_BUFFER
+    static void setup(size_t baseOffset = 0) {
+        int dummy[] = { 0, (setupAttrib<Attrs>(baseOffset), 0)... };
+        (void)dummy;
+    }
+
+    // compare with the active attributes of a linked program:
+    // reports shader inputs missing from the format and attributes the shader never reads
+    static bool verify(GLuint program, const char* name) {
+        bool ok = true;
+        bool used[16] = { false };
+
+        GLint count = 0;
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+        for (GLint i = 0; i < count; i++) {
+            char attribName[64];
+            GLint arraySize;
+            GLenum glslType;
+            glGetActiveAttrib(program, i, sizeof(attribName), NULL, &arraySize, &glslType, attribName);
+            GLint location = glGetAttribLocation(program, attribName);
+            if (location < 0) continue;     // built-ins such as gl_VertexID
+
+            GLint components;
+            size_t size;
+            if (!AttribAt<Attrs...>::find(location, components, size)) {
+                std::cout << "VERTEX FORMAT: " << name << " reads " << attribName
+                          << " (location " << location << ") which the mesh does not supply" << std::endl;
+                ok = false;
+                continue;
+            }
+            if (location < 16) used[location] = true;
+            if (components != glslComponents(glslType)) {
+                std::cout << "VERTEX FORMAT: " << name << " declares " << attribName << " with "
+                          << glslComponents(glslType) << " components, the mesh supplies " << components << std::endl;
+                ok = false;
+            }
+        }
+
+        int dummy[] = { 0, (reportUnused<Attrs>(used, name, ok), 0)... };
+        (void)dummy;
+        return ok;
+    }
+
+private:
+    template <typename A> static void setupAttrib(size_t baseOffset) {
+        size_t attribOffset = baseOffset + AttribOffset<A, Attrs...>::value;
+        glVertexAttribPointer(A::location, A::components, A::type, A::normalized, (GLsizei)stride, (GLvoid*)attribOffset);
+        glEnableVertexAttribArray(A::location);
+    }
+
+    template <typename A> static void reportUnused(const bool* used, const char* name, bool& ok) {
+        if (A::location < 16 && !used[A::location]) {
+            std::cout << "VERTEX FORMAT: " << name << " never reads location " << A::location
+                      << " (" << A::size << " bytes per vertex fetched for nothing)" << std::endl;
+            ok = false;
+        }
+    }
+
+    static GLint glslComponents(GLenum glslType) {
+        switch (glslType) {
+        case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: return 1;
+        case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: return 2;
+        case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: return 3;
+        case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: return 4;
+        default: return 0;
+        }
+    }
+};
+
+#endif
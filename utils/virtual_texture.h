@@ -0,0 +1,555 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+// Virtual texturing: a map far larger than the GPU budget is cut into a tile
+// pyramid on disk; only the tiles the current view needs live in a fixed page cache.
+//      if (!vt_current("world_map.jpg", "world_map.vt"))  // missing, old format or source changed
+//          vt_bake("world_map.jpg", "world_map.vt");
+//      VirtualTexture vt("world_map.vt", 8);             // 8x8 cache pages
+//      per frame:
+//          vt.beginFeedback(width, height);               // small integer target
+//          vt.apply(feedbackProgram, 0, 1, true);  draw the textured objects
+//          vt.endFeedback();                              // async readback (PBO)
+//          vt.update();                                   // requests, uploads, eviction
+//          vt.apply(program, 0, 1, false);  draw the textured objects
+//
+// The feedback pass writes, per pixel, the page (x, y, level) the fragment would
+// sample. update() reads the previous frame's feedback, keeps the needed pages (and
+// their ancestors) hot in an LRU, queues the missing ones coarse-first to a loader
+// thread and uploads at most maxUploadsPerFrame finished tiles into the cache atlas.
+// The page table is a mip chain with one RGBA8 texel per page: the cache slot and
+// level of the finest resident ancestor. The single tile of the coarsest level is
+// pinned, so every lookup finds something and missing detail only looks blurry.
+//
+// GPU memory is the cache atlas plus the page table, whatever the map size.
+// Tiles carry a border of neighbouring texels so bilinear filtering stays inside a page.
+// The baker decodes the source with stb_image, so the source itself must fit in RAM;
+// the renderer never holds more than the cache. The header records the size and
+// modification time of the source it was baked from, like the mesh_import cache.
+
+#include <GL/glew.h>
+#include <stb_image.h>
+#include <gl_state.h>
+#include <vector>
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define VIRTUAL_TEXTURE_VERSION 2
+
+struct VirtualTextureHeader {
+    char magic[4];                          // "VTEX"
+    uint32_t version;
+    uint32_t width, height;                 // level 0 texels
+    uint32_t tileSize, border;              // a stored tile is tileSize + 2 * border square, RGBA8
+    uint32_t levels;
+    uint32_t pages;                         // page table side: level 0 tiles, rounded up to a power of two
+    uint64_t sourceSize;                    // the image it was baked from
+    int64_t sourceTime;                     // its modification time
+};
+
+// size of the pyramid levels and where their tiles start in the file (in tiles)
+struct VirtualTextureLayout {
+    std::vector<uint32_t> width, height, tilesX, tilesY, firstTile;
+
+    void build(const VirtualTextureHeader& header) {
+        uint32_t w = header.width, h = header.height, first = 0;
+        for (uint32_t level = 0; level < header.levels; level++) {
+            width.push_back(w);
+            height.push_back(h);
+            tilesX.push_back((w + header.tileSize - 1) / header.tileSize);
+            tilesY.push_back((h + header.tileSize - 1) / header.tileSize);
+            firstTile.push_back(first);
+            first += tilesX.back() * tilesY.back();
+            w = (w + 1) / 2;
+            h = (h + 1) / 2;
+        }
+    }
+};
+
+// whether `path` is a pyramid of this version baked from the current `sourcePath`;
+// without the source any valid pyramid is current
+inline bool vt_current(const char* sourcePath, const char* path) {
+    VirtualTextureHeader header;
+    std::ifstream file(path, std::ios::binary);
+    if (!file || !file.read((char*)&header, sizeof(header)) || memcmp(header.magic, "VTEX", 4) != 0
+        || header.version != VIRTUAL_TEXTURE_VERSION) return false;
+    struct stat source;
+    if (stat(sourcePath, &source) != 0) return true;
+    if (header.sourceSize == (uint64_t)source.st_size && header.sourceTime == (int64_t)source.st_mtime) return true;
+    std::cout << "VTEX: " << sourcePath << " changed since " << path << " was baked" << std::endl;
+    return false;
+}
+
+// tile pyramid of an image: header, then every level's tiles row by row, finest level first
+inline bool vt_bake(const char* sourcePath, const char* path, int tileSize = 128, int border = 4) {
+    struct stat source;
+    bool haveSource = stat(sourcePath, &source) == 0;
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load(false);   // same orientation as the whole-texture upload
+    unsigned char* image = stbi_load(sourcePath, &width, &height, &channels, 4);
+    if (!image) {
+        std::cout << "VTEX: " << sourcePath << " loading error" << std::endl;
+        return false;
+    }
+    std::vector<unsigned char> level(image, image + (size_t)width * height * 4);
+    stbi_image_free(image);
+
+    VirtualTextureHeader header;
+    memcpy(header.magic, "VTEX", 4);
+    header.version = VIRTUAL_TEXTURE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.tileSize = tileSize;
+    header.border = border;
+    header.sourceSize = haveSource ? (uint64_t)source.st_size : 0;
+    header.sourceTime = haveSource ? (int64_t)source.st_mtime : 0;
+    uint32_t tiles = (uint32_t)std::max((width + tileSize - 1) / tileSize, (height + tileSize - 1) / tileSize);
+    header.pages = 1;
+    header.levels = 1;
+    while (header.pages < tiles) {
+        header.pages *= 2;
+        header.levels++;
+    }
+    VirtualTextureLayout layout;
+    layout.build(header);
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cout << "VTEX: cannot write " << path << std::endl;
+        return false;
+    }
+    out.write((const char*)&header, sizeof(header));
+
+    int padded = tileSize + 2 * border;
+    std::vector<unsigned char> tile((size_t)padded * padded * 4);
+    for (uint32_t l = 0; l < header.levels; l++) {
+        int w = layout.width[l], h = layout.height[l];
+        for (uint32_t ty = 0; ty < layout.tilesY[l]; ty++) {
+            for (uint32_t tx = 0; tx < layout.tilesX[l]; tx++) {
+                // edge texels repeat past the image
+                for (int y = 0; y < padded; y++) {
+                    int sy = std::min(std::max((int)(ty * tileSize) + y - border, 0), h - 1);
+                    for (int x = 0; x < padded; x++) {
+                        int sx = std::min(std::max((int)(tx * tileSize) + x - border, 0), w - 1);
+                        memcpy(&tile[((size_t)y * padded + x) * 4], &level[((size_t)sy * w + sx) * 4], 4);
+                    }
+                }
+                out.write((const char*)tile.data(), tile.size());
+            }
+        }
+
+        // 2x2 box filter to the next level
+        if (l + 1 == header.levels) break;
+        int nw = layout.width[l + 1], nh = layout.height[l + 1];
+        std::vector<unsigned char> next((size_t)nw * nh * 4);
+        for (int y = 0; y < nh; y++) {
+            int y0 = 2 * y, y1 = std::min(2 * y + 1, h - 1);
+            for (int x = 0; x < nw; x++) {
+                int x0 = 2 * x, x1 = std::min(2 * x + 1, w - 1);
+                for (int c = 0; c < 4; c++) {
+                    int sum = level[((size_t)y0 * w + x0) * 4 + c] + level[((size_t)y0 * w + x1) * 4 + c]
+                            + level[((size_t)y1 * w + x0) * 4 + c] + level[((size_t)y1 * w + x1) * 4 + c];
+                    next[((size_t)y * nw + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        level.swap(next);
+    }
+    std::cout << "VTEX: " << sourcePath << " " << width << "x" << height << " baked into " << header.levels
+              << " levels of " << tileSize << " texel tiles (" << path << ")" << std::endl;
+    return true;
+}
+
+class VirtualTexture {
+public:
+    VirtualTextureHeader header;
+    VirtualTextureLayout layout;
+    bool valid = false;
+
+    unsigned int pageTable = 0;             // RGBA8 mip chain: slot x, slot y, resident level
+    unsigned int pageCache = 0;             // RGBA8 atlas of cacheSide x cacheSide padded tiles
+    int cacheSide;
+
+    // feedback target, 1 / feedbackDivisor of the window
+    int feedbackDivisor = 8;
+    unsigned int feedbackFBO = 0, feedbackTexture = 0, feedbackDepth = 0;
+    unsigned int readback[2] = { 0, 0 };    // PBOs, read one frame after they were written
+    int maxUploadsPerFrame = 16;
+
+    // statistics, cumulative
+    unsigned int requests = 0, uploads = 0, evictions = 0, dropped = 0;
+
+    VirtualTexture(const char* path, int cacheSide = 8) {
+        this->cacheSide = cacheSide;
+        this->path = path;
+        file.open(path, std::ios::binary);
+        if (!file || !file.read((char*)&header, sizeof(header)) || memcmp(header.magic, "VTEX", 4) != 0
+            || header.version != VIRTUAL_TEXTURE_VERSION) {
+            std::cout << "VTEX: " << path << " is not a virtual texture (version " << VIRTUAL_TEXTURE_VERSION << ")" << std::endl;
+            return;
+        }
+        layout.build(header);
+        tileBytes = (size_t)padded() * padded() * 4;
+
+        // page cache; slot 0 holds the pinned coarsest tile
+        glGenTextures(1, &pageCache);
+        gl_state().bindTexture(GL_TEXTURE_2D, pageCache);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheSide * padded(), cacheSide * padded(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        MEMORY_TRACK_TEXTURE(pageCache, texture_bytes(GL_RGBA8, cacheSide * padded(), cacheSide * padded()), MEMORY_TEXTURE, "vtex page cache");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        slotPage.assign(cacheSide * cacheSide, NO_PAGE);
+        slotUsed.assign(cacheSide * cacheSide, 0);
+
+        glGenTextures(1, &pageTable);
+        gl_state().bindTexture(GL_TEXTURE_2D, pageTable);
+        for (uint32_t l = 0; l < header.levels; l++) {
+            int side = header.pages >> l;
+            glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, side, side, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            table.push_back(std::vector<unsigned char>((size_t)side * side * 4));
+        }
+        MEMORY_TRACK_TEXTURE(pageTable, texture_bytes(GL_RGBA8, header.pages, header.pages, 1, header.levels), MEMORY_TEXTURE, "vtex page table");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.levels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        std::vector<unsigned char> pixels(tileBytes);
+        uint64_t top = key(header.levels - 1, 0, 0);
+        if (!readTile(file, top, pixels.data())) return;
+        place(top, 0, pixels.data());
+        slotUsed[0] = PINNED;
+        rebuildTable();
+
+        glGenBuffers(2, readback);
+        loader = std::thread(&VirtualTexture::loaderLoop, this);
+        valid = true;
+        std::cout << "VTEX: " << header.width << "x" << header.height << ", " << header.levels << " levels, cache of "
+                  << cacheSide * cacheSide << " pages (" << (cacheSide * padded()) * (cacheSide * padded()) * 4 / 1024
+                  << " KB)" << std::endl;
+    }
+
+    ~VirtualTexture() {
+        if (loader.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                quit = true;
+            }
+            wake.notify_one();
+            loader.join();
+        }
+        if (pageTable != 0) gl_state().deleteTextures(1, &pageTable);
+        if (pageCache != 0) gl_state().deleteTextures(1, &pageCache);
+        releaseFeedback();
+        if (readback[0] != 0) gl_state().deleteBuffers(2, readback);
+    }
+
+    // render the textured objects with the feedback program after this
+    void beginFeedback(int width, int height) {
+        screenWidth = width;
+        screenHeight = height;
+        int w = std::max(width / feedbackDivisor, 1), h = std::max(height / feedbackDivisor, 1);
+        if (w != feedbackWidth || h != feedbackHeight) createFeedback(w, h);
+
+        gl_state().bindFramebuffer(feedbackFBO);
+        gl_state().viewport(0, 0, feedbackWidth, feedbackHeight);
+        GLuint none[4] = { 0, 0, 0, 0 };
+        glClearBufferuiv(GL_COLOR, 0, none);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    // queue the readback and return to the window
+    void endFeedback() {
+        gl_state().bindBuffer(GL_PIXEL_PACK_BUFFER, readback[writeIndex]);
+        glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, (void*)0);
+        gl_state().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readbackPixels[writeIndex] = feedbackWidth * feedbackHeight;
+        writeIndex ^= 1;
+
+        gl_state().bindFramebuffer(0);
+        gl_state().viewport(0, 0, screenWidth, screenHeight);
+    }
+
+    // consume last frame's feedback, stream, upload and refresh the page table
+    void update() {
+        if (!valid) return;
+        frame++;
+        collectFeedback();
+
+        // missing pages, coarse first: a blurry page on screen beats a sharp one later
+        std::vector<uint64_t> missing;
+        for (std::unordered_set<uint64_t>::iterator it = needed.begin(); it != needed.end(); ++it) {
+            std::unordered_map<uint64_t, int>::iterator page = resident.find(*it);
+            if (page != resident.end()) {
+                if (slotUsed[page->second] != PINNED) slotUsed[page->second] = frame;
+            }
+            else if (pending.find(*it) == pending.end()) missing.push_back(*it);
+        }
+        std::sort(missing.begin(), missing.end(), [](uint64_t a, uint64_t b) { return a > b; });  // level is the top field
+        {
+            // what the loader has not started yet is replaced by this frame's needs
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < queue.size(); i++) pending.erase(queue[i]);
+            queue.assign(missing.begin(), missing.end());
+            for (size_t i = 0; i < missing.size(); i++) pending.insert(missing[i]);
+            requests += (unsigned int)missing.size();
+        }
+        if (!missing.empty()) wake.notify_one();
+
+        bool changed = false;
+        for (int n = 0; n < maxUploadsPerFrame; n++) {
+            Loaded tile;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (loaded.empty()) break;
+                tile = std::move(loaded.front());
+                loaded.pop_front();
+            }
+            pending.erase(tile.page);
+            if (tile.pixels.empty() || resident.count(tile.page)) continue;
+            int slot = freeSlot();
+            if (slot < 0) {
+                dropped++;                  // every page in the cache is on screen: the budget is too small
+                continue;
+            }
+            place(tile.page, slot, tile.pixels.data());
+            changed = true;
+        }
+        if (changed) rebuildTable();
+    }
+
+    // samplers and layout uniforms of a program using the virtual texture (in use)
+    void apply(unsigned int program, int tableUnit, int cacheUnit, bool feedback) {
+        gl_state().bindTextureUnit(tableUnit, GL_TEXTURE_2D, pageTable);
+        gl_state().bindTextureUnit(cacheUnit, GL_TEXTURE_2D, pageCache);
+        glUniform1i(glGetUniformLocation(program, "pageTable"), tableUnit);
+        glUniform1i(glGetUniformLocation(program, "pageCache"), cacheUnit);
+        float virtualSize = (float)(header.pages * header.tileSize);
+        glUniform2f(glGetUniformLocation(program, "virtualScale"), header.width / virtualSize, header.height / virtualSize);
+        glUniform1f(glGetUniformLocation(program, "pages"), (float)header.pages);
+        glUniform1i(glGetUniformLocation(program, "levels"), (int)header.levels);
+        glUniform1f(glGetUniformLocation(program, "tileSize"), (float)header.tileSize);
+        glUniform1f(glGetUniformLocation(program, "border"), (float)header.border);
+        glUniform1f(glGetUniformLocation(program, "cacheTexels"), (float)(cacheSide * padded()));
+        // derivatives of the small target are feedbackDivisor times larger
+        glUniform1f(glGetUniformLocation(program, "lodBias"), feedback ? -log2f((float)feedbackDivisor) : 0.0f);
+    }
+
+    int residentPages() const {
+        return (int)resident.size();
+    }
+
+private:
+    static const uint64_t NO_PAGE = ~(uint64_t)0;
+    static const unsigned int PINNED = ~0u;
+
+    struct Loaded {
+        uint64_t page;
+        std::vector<unsigned char> pixels;  // empty: the read failed
+    };
+
+    std::ifstream file;                     // main thread: header and pinned tile
+    std::string path;                       // the loader thread opens its own stream
+    size_t tileBytes = 0;
+    unsigned int frame = 0;
+    int screenWidth = 0, screenHeight = 0;
+    int feedbackWidth = 0, feedbackHeight = 0;
+    int writeIndex = 0;
+    int readbackPixels[2] = { 0, 0 };
+
+    std::unordered_map<uint64_t, int> resident;    // page -> cache slot
+    std::vector<uint64_t> slotPage;
+    std::vector<unsigned int> slotUsed;             // frame of last use, PINNED for the coarsest tile
+    std::unordered_set<uint64_t> needed, pending;   // this frame's pages / queued or loading
+    std::vector<std::vector<unsigned char>> table;  // CPU copy of the page table levels
+
+    std::thread loader;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<uint64_t> queue;
+    std::deque<Loaded> loaded;
+    bool quit = false;
+
+    int padded() const {
+        return (int)(header.tileSize + 2 * header.border);
+    }
+
+    // level in the top bits, so sorting keys descending puts coarse levels first
+    static uint64_t key(uint32_t level, uint32_t x, uint32_t y) {
+        return (uint64_t)level << 48 | (uint64_t)y << 24 | x;
+    }
+    static uint32_t keyLevel(uint64_t k) { return (uint32_t)(k >> 48); }
+    static uint32_t keyY(uint64_t k) { return (uint32_t)(k >> 24) & 0xFFFFFF; }
+    static uint32_t keyX(uint64_t k) { return (uint32_t)k & 0xFFFFFF; }
+
+    bool readTile(std::ifstream& in, uint64_t page, unsigned char* pixels) {
+        uint32_t l = keyLevel(page);
+        uint64_t index = layout.firstTile[l] + (uint64_t)keyY(page) * layout.tilesX[l] + keyX(page);
+        in.clear();
+        in.seekg((std::streamoff)(sizeof(VirtualTextureHeader) + index * tileBytes));
+        return (bool)in.read((char*)pixels, tileBytes);
+    }
+
+    void loaderLoop() {
+        std::ifstream in;
+        in.open(path.c_str(), std::ios::binary);
+        for (;;) {
+            uint64_t page;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return quit || !queue.empty(); });
+                if (quit) return;
+                page = queue.front();
+                queue.pop_front();
+            }
+            Loaded tile;
+            tile.page = page;
+            tile.pixels.resize(tileBytes);
+            if (!readTile(in, page, tile.pixels.data())) tile.pixels.clear();
+            std::lock_guard<std::mutex> lock(mutex);
+            loaded.push_back(std::move(tile));
+        }
+    }
+
+    // pages of the previous frame's feedback, with their ancestors
+    void collectFeedback() {
+        int index = writeIndex;             // written one frame ago
+        if (readbackPixels[index] == 0) return;
+        needed.clear();
+        gl_state().bindBuffer(GL_PIXEL_PACK_BUFFER, readback[index]);
+        const GLushort* texels = (const GLushort*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+            readbackPixels[index] * 4 * sizeof(GLushort), GL_MAP_READ_BIT);
+        if (texels != NULL) {
+            uint64_t last = NO_PAGE;
+            for (int i = 0; i < readbackPixels[index]; i++, texels += 4) {
+                if (texels[3] == 0) continue;
+                uint32_t level = std::min((uint32_t)texels[2], header.levels - 1);
+                uint32_t x = texels[0], y = texels[1];
+                if (x >= layout.tilesX[level] || y >= layout.tilesY[level]) continue;
+                uint64_t page = key(level, x, y);
+                if (page == last) continue;     // neighbouring pixels mostly share a page
+                last = page;
+                for (; level < header.levels && needed.insert(key(level, x, y)).second; level++) {
+                    x /= 2;
+                    y /= 2;
+                }
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        gl_state().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // an empty slot, or the least recently used page not needed by the last frame
+    int freeSlot() {
+        int best = -1;
+        for (int slot = 0; slot < (int)slotPage.size(); slot++) {
+            if (slotPage[slot] == NO_PAGE) return slot;
+            if (slotUsed[slot] == PINNED || slotUsed[slot] >= frame) continue;
+            if (best < 0 || slotUsed[slot] < slotUsed[best]) best = slot;
+        }
+        if (best >= 0) {
+            resident.erase(slotPage[best]);
+            slotPage[best] = NO_PAGE;
+            evictions++;
+        }
+        return best;
+    }
+
+    void place(uint64_t page, int slot, const unsigned char* pixels) {
+        gl_state().bindTexture(GL_TEXTURE_2D, pageCache);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % cacheSide) * padded(), (slot / cacheSide) * padded(),
+                        padded(), padded(), GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        resident[page] = slot;
+        slotPage[slot] = page;
+        slotUsed[slot] = frame;
+        uploads++;
+    }
+
+    // every page points at its finest resident ancestor (itself when resident)
+    void rebuildTable() {
+        for (int l = (int)header.levels - 1; l >= 0; l--) {
+            int side = header.pages >> l;
+            std::vector<unsigned char>& entries = table[l];
+            for (int y = 0; y < side; y++) {
+                for (int x = 0; x < side; x++) {
+                    unsigned char* entry = &entries[((size_t)y * side + x) * 4];
+                    std::unordered_map<uint64_t, int>::iterator page = resident.find(key(l, x, y));
+                    if (page != resident.end()) {
+                        entry[0] = (unsigned char)(page->second % cacheSide);
+                        entry[1] = (unsigned char)(page->second / cacheSide);
+                        entry[2] = (unsigned char)l;
+                        entry[3] = 255;
+                    }
+                    else if (l + 1 < (int)header.levels) {
+                        memcpy(entry, &table[l + 1][((size_t)(y / 2) * (side / 2) + x / 2) * 4], 4);
+                    }
+                }
+            }
+        }
+        gl_state().bindTexture(GL_TEXTURE_2D, pageTable);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (uint32_t l = 0; l < header.levels; l++) {
+            int side = header.pages >> l;
+            glTexSubImage2D(GL_TEXTURE_2D, l, 0, 0, side, side, GL_RGBA, GL_UNSIGNED_BYTE, table[l].data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    void createFeedback(int width, int height) {
+        releaseFeedback();
+        feedbackWidth = width;
+        feedbackHeight = height;
+
+        glGenTextures(1, &feedbackTexture);
+        gl_state().bindTexture(GL_TEXTURE_2D, feedbackTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16UI, width, height, 0, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, NULL);
+        MEMORY_TRACK_TEXTURE(feedbackTexture, texture_bytes(GL_RGBA16UI, width, height), MEMORY_RENDER_TARGET, "vtex feedback");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glGenRenderbuffers(1, &feedbackDepth);
+        glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        MEMORY_TRACK_RENDERBUFFER(feedbackDepth, texture_bytes(GL_DEPTH_COMPONENT24, width, height), "vtex feedback depth");
+
+        glGenFramebuffers(1, &feedbackFBO);
+        gl_state().bindFramebuffer(feedbackFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "VTEX: feedback framebuffer incomplete" << std::endl;
+
+        for (int i = 0; i < 2; i++) {
+            gl_state().bindBuffer(GL_PIXEL_PACK_BUFFER, readback[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)width * height * 4 * sizeof(GLushort), NULL, GL_STREAM_READ);
+            MEMORY_TRACK_BUFFER(readback[i], (size_t)width * height * 4 * sizeof(GLushort), MEMORY_BUFFER, "vtex readback");
+            readbackPixels[i] = 0;
+        }
+        gl_state().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    void releaseFeedback() {
+        if (feedbackFBO != 0) gl_state().deleteFramebuffers(1, &feedbackFBO);
+        if (feedbackTexture != 0) gl_state().deleteTextures(1, &feedbackTexture);
+        if (feedbackDepth != 0) gl_state().deleteRenderbuffers(1, &feedbackDepth);
+        feedbackFBO = feedbackTexture = feedbackDepth = 0;
+    }
+
+    VirtualTexture(const VirtualTexture&);
+    VirtualTexture& operator=(const VirtualTexture&);
+};
+
+#endif